@@ -0,0 +1,54 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// axis aligned bounding box, empty until something is added to it
+struct AABB
+{
+    glm::vec3 Min = glm::vec3(FLT_MAX);
+    glm::vec3 Max = glm::vec3(-FLT_MAX);
+
+    bool Empty() const { return Min.x > Max.x; }
+    glm::vec3 Center() const { return (Min + Max) * 0.5f; }
+    glm::vec3 Extents() const { return (Max - Min) * 0.5f; }
+
+    void Extend(const glm::vec3& point)
+    {
+        Min = glm::min(Min, point);
+        Max = glm::max(Max, point);
+    }
+
+    void Extend(const AABB& box)
+    {
+        Min = glm::min(Min, box.Min);
+        Max = glm::max(Max, box.Max);
+    }
+
+    // the box around this box after transform (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+    AABB Transformed(const glm::mat4& transform) const
+    {
+        if (Empty())
+            return *this;
+        glm::vec3 center = glm::vec3(transform * glm::vec4(Center(), 1.0f));
+        glm::vec3 extents = Extents();
+        glm::vec3 worldExtents;
+        for (int row = 0; row < 3; row++)
+            worldExtents[row] = std::abs(transform[0][row]) * extents.x + std::abs(transform[1][row]) * extents.y + std::abs(transform[2][row]) * extents.z;
+        AABB box;
+        box.Min = center - worldExtents;
+        box.Max = center + worldExtents;
+        return box;
+    }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 Center = glm::vec3(0.0f);
+    float Radius = 0.0f;
+};
+#endif
@@ -0,0 +1,213 @@
+#ifndef BRDF_LUT_H
+#define BRDF_LUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// The split sum BRDF lookup table. x is NdotV, y is roughness, red and green are the scale and bias applied to F0
+// (exactly what brdf.fs integrates). The optional blue channel holds the multiscatter energy compensation 1 / (A + B) - 1,
+// so the single scattering specular can be scaled by 1 + F0 * b to give back the energy lost at high roughness.
+// The table does not depend on the scene, it is generated offline by asset-pipeline and shipped as a half float file.
+class BrdfLut
+{
+public:
+    static const unsigned int DEFAULT_SIZE = 512;
+    static const unsigned int DEFAULT_SAMPLES = 1024;
+
+    unsigned int Size = 0;
+    unsigned int Channels = 0;
+    unsigned int Samples = 0;
+    // Size * Size * Channels half floats, row y = roughness
+    std::vector<uint16_t> Texels;
+
+    // integrates the table on the CPU with the same sampling as brdf.fs, rows are spread over the pool
+    // ------------------------------------------------------------------------
+    static BrdfLut Generate(ThreadPool& pool, unsigned int size = DEFAULT_SIZE, unsigned int samples = DEFAULT_SAMPLES, bool multiscatter = true)
+    {
+        BrdfLut lut;
+        lut.Size = size;
+        lut.Channels = multiscatter ? 3 : 2;
+        lut.Samples = samples;
+        lut.Texels.resize((size_t)size * size * lut.Channels);
+        pool.ParallelFor(size, [&lut](unsigned int y)
+        {
+            float roughness = ((float)y + 0.5f) / (float)lut.Size;
+            for (unsigned int x = 0; x < lut.Size; x++)
+            {
+                float NdotV = ((float)x + 0.5f) / (float)lut.Size;
+                glm::vec2 ab = integrate(NdotV, roughness, lut.Samples);
+                uint16_t* texel = &lut.Texels[((size_t)y * lut.Size + x) * lut.Channels];
+                texel[0] = glm::packHalf1x16(ab.x);
+                texel[1] = glm::packHalf1x16(ab.y);
+                if (lut.Channels == 3)
+                    texel[2] = glm::packHalf1x16(1.0f / std::max(ab.x + ab.y, 1e-4f) - 1.0f);
+            }
+        });
+        return lut;
+    }
+
+    // reads back a table that was baked on the GPU, RG from brdf.fs or RGB with the multiscatter channel from brdf.comp
+    // ------------------------------------------------------------------------
+    static BrdfLut ReadBack(unsigned int texture, unsigned int samples = DEFAULT_SAMPLES, unsigned int channels = 2)
+    {
+        BrdfLut lut;
+        GLint size = 0;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &size);
+        lut.Size = (unsigned int)size;
+        lut.Channels = channels;
+        lut.Samples = samples;
+        lut.Texels.resize((size_t)lut.Size * lut.Size * lut.Channels);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, channels == 3 ? GL_RGB : GL_RG, GL_HALF_FLOAT, lut.Texels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        return lut;
+    }
+
+    // returns false on a missing or damaged file
+    // ------------------------------------------------------------------------
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        Header header;
+        file.read((char*)&header, sizeof(header));
+        if (!file || header.magic != MAGIC || header.version != VERSION)
+        {
+            std::cout << "ERROR::BRDF_LUT::BAD_HEADER " << path << std::endl;
+            return false;
+        }
+        if (header.size == 0 || header.size > 4096 || (header.channels != 2 && header.channels != 3))
+        {
+            std::cout << "ERROR::BRDF_LUT::BAD_HEADER " << path << std::endl;
+            return false;
+        }
+        std::vector<uint16_t> texels((size_t)header.size * header.size * header.channels);
+        file.read((char*)texels.data(), texels.size() * sizeof(uint16_t));
+        if (!file)
+        {
+            std::cout << "ERROR::BRDF_LUT::DAMAGED_FILE " << path << std::endl;
+            return false;
+        }
+        Size = header.size;
+        Channels = header.channels;
+        Samples = header.samples;
+        Texels.swap(texels);
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    bool Save(const std::string& path) const
+    {
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            Header header = { MAGIC, VERSION, Size, Channels, Samples };
+            file.write((const char*)&header, sizeof(header));
+            file.write((const char*)Texels.data(), Texels.size() * sizeof(uint16_t));
+            if (!file)
+            {
+                std::cout << "ERROR::BRDF_LUT::CANNOT_WRITE " << tempPath << std::endl;
+                return false;
+            }
+        }
+        std::remove(path.c_str());
+        std::rename(tempPath.c_str(), path.c_str());
+        return true;
+    }
+
+    // creates an RG16F (or RGB16F with the multiscatter channel) texture, clamped and linearly filtered
+    // ------------------------------------------------------------------------
+    unsigned int Upload() const
+    {
+        GLenum internalFormat = Channels == 3 ? GL_RGB16F : GL_RG16F;
+        GLenum format = Channels == 3 ? GL_RGB : GL_RG;
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Size, Size, 0, format, GL_HALF_FLOAT, Texels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x54554C42; // "BLUT"
+    static const uint32_t VERSION = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t size;
+        uint32_t channels;
+        uint32_t samples;
+    };
+
+    // the functions below mirror brdf.fs line for line, keep them in sync
+    static float radicalInverseVdC(uint32_t bits)
+    {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return (float)bits * 2.3283064365386963e-10f;
+    }
+
+    static float geometrySchlickGGX(float NdotV, float roughness)
+    {
+        float k = (roughness * roughness) / 2.0f;
+        return NdotV / (NdotV * (1.0f - k) + k);
+    }
+
+    // N is +z, so the GGX half vector needs no tangent frame
+    static glm::vec2 integrate(float NdotV, float roughness, unsigned int samples)
+    {
+        const float PI = 3.14159265359f;
+        glm::vec3 V(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+        float a = roughness * roughness;
+        float A = 0.0f;
+        float B = 0.0f;
+        for (unsigned int i = 0; i < samples; i++)
+        {
+            glm::vec2 Xi((float)i / (float)samples, radicalInverseVdC(i));
+            float phi = 2.0f * PI * Xi.x;
+            float cosTheta = std::sqrt((1.0f - Xi.y) / (1.0f + (a * a - 1.0f) * Xi.y));
+            float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+            glm::vec3 H(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+            glm::vec3 L = glm::normalize(2.0f * glm::dot(V, H) * H - V);
+
+            float NdotL = std::max(L.z, 0.0f);
+            float NdotH = std::max(H.z, 0.0f);
+            float VdotH = std::max(glm::dot(V, H), 0.0f);
+            if (NdotL > 0.0f)
+            {
+                float G = geometrySchlickGGX(NdotV, roughness) * geometrySchlickGGX(NdotL, roughness);
+                float G_Vis = (G * VdotH) / (NdotH * NdotV);
+                float Fc = std::pow(1.0f - VdotH, 5.0f);
+                A += (1.0f - Fc) * G_Vis;
+                B += Fc * G_Vis;
+            }
+        }
+        return glm::vec2(A, B) / (float)samples;
+    }
+};
+#endif
@@ -0,0 +1,90 @@
+#ifndef FRAME_DATA_H
+#define FRAME_DATA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_ring.h>
+
+#include <iostream>
+
+// mirrors the FrameData block (std140, uniform binding 0) that every shader drawing with the camera declares.
+// the block ends at exposure, the padding rounds a record up to 512 bytes so every record starts at an offset
+// glBindBufferRange accepts (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT is at most 256)
+struct FrameData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec3 camPos;
+    // seconds since start
+    float time;
+    // scene color is multiplied by it before tonemapping
+    float exposure;
+    float padding[27];
+
+    // fills in the products and inverses, the camera position is taken from the inverse view
+    // ------------------------------------------------------------------------
+    static FrameData Camera(const glm::mat4& view, const glm::mat4& projection, float time = 0.0f, float exposure = 1.0f)
+    {
+        FrameData data = {};
+        data.view = view;
+        data.projection = projection;
+        data.viewProjection = projection * view;
+        data.inverseView = glm::inverse(view);
+        data.inverseProjection = glm::inverse(projection);
+        data.inverseViewProjection = glm::inverse(data.viewProjection);
+        data.camPos = glm::vec3(data.inverseView[3]);
+        data.time = time;
+        data.exposure = exposure;
+        return data;
+    }
+};
+
+static_assert(sizeof(FrameData) == 512, "FrameData has to stay a multiple of the largest uniform buffer offset alignment");
+
+// The FrameData records of a frame in a FrameRing of uniform buffers. Every view rendered in a frame (the camera, a
+// shadow map...) pushes one record, Bind() points binding 0 at it. Programs never upload their own matrices,
+// so switching views is one glBindBufferRange however many programs read them.
+class FrameDataBuffer
+{
+public:
+    static const unsigned int BINDING = 0;
+
+    // constructor, capacity is the number of views per frame
+    // ------------------------------------------------------------------------
+    FrameDataBuffer(unsigned int capacity = 1)
+        : ring(capacity, GL_UNIFORM_BUFFER)
+    {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment > 0 && sizeof(FrameData) % (size_t)alignment != 0)
+            std::cout << "ERROR::FRAME_DATA::UNALIGNED_RECORDS " << alignment << std::endl;
+    }
+
+    // moves to the next section of the ring, waiting for the GPU if it is still reading it
+    void BeginFrame() { ring.BeginFrame(); }
+    // fences the section, call once every draw of the frame is queued
+    void EndFrame() { ring.EndFrame(); }
+
+    // copies data into this frame's section and returns its index for Bind()
+    // ------------------------------------------------------------------------
+    unsigned int Push(const FrameData& data)
+    {
+        return ring.Push(data);
+    }
+
+    // makes record index the FrameData block of every program
+    // ------------------------------------------------------------------------
+    void Bind(unsigned int index) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, ring.Buffer(), (GLintptr)index * sizeof(FrameData), sizeof(FrameData));
+    }
+
+private:
+    FrameRing<FrameData> ring;
+};
+#endif
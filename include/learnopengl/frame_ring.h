@@ -0,0 +1,106 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_object.h>
+
+#include <iostream>
+
+// Per-frame records (transforms, material handles...) written straight into a persistently mapped buffer.
+// The buffer holds FRAMES sections of capacity records. Each frame writes into the next section while the GPU may still
+// read the previous ones, so the CPU only waits when it laps a frame that is still in flight. The whole buffer is
+// bound once, a record is found by its global index: shaders read it through gl_BaseInstance or gl_DrawID.
+// Buffers of non-indexed targets (GL_DRAW_INDIRECT_BUFFER) are left unbound, bind Buffer() and offset by FrameBase().
+template <typename Record>
+class FrameRing
+{
+public:
+    static const unsigned int FRAMES = 3;
+
+    // constructor, creates the buffer and binds it to binding of target (GL_SHADER_STORAGE_BUFFER or GL_UNIFORM_BUFFER).
+    // a negative binding skips the indexed bind
+    // ------------------------------------------------------------------------
+    FrameRing(unsigned int capacity, GLenum target, int binding = -1)
+        : capacity(capacity), frame(0), count(0), records(nullptr)
+    {
+        for (unsigned int i = 0; i < FRAMES; i++)
+            fences[i] = 0;
+        buffer = GLBuffer::Create();
+        glBindBuffer(target, buffer.ID());
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, (GLsizeiptr)sizeof(Record) * capacity * FRAMES, NULL, flags);
+        records = (Record*)glMapBufferRange(target, 0, (GLsizeiptr)sizeof(Record) * capacity * FRAMES, flags);
+        glBindBuffer(target, 0);
+        if (binding >= 0)
+            glBindBufferBase(target, binding, buffer.ID());
+        if (!records)
+            std::cout << "ERROR::FRAME_RING::CANNOT_MAP_BUFFER" << std::endl;
+    }
+
+    ~FrameRing()
+    {
+        for (unsigned int i = 0; i < FRAMES; i++)
+            if (fences[i])
+                glDeleteSync(fences[i]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.ID());
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    // moves to the next section, waiting for the GPU to finish the frame that wrote it last
+    // ------------------------------------------------------------------------
+    void BeginFrame()
+    {
+        frame = (frame + 1) % FRAMES;
+        count = 0;
+        if (fences[frame])
+        {
+            while (glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(fences[frame]);
+            fences[frame] = 0;
+        }
+    }
+
+    // copies record into this frame's section and returns its global index. when the section is full the last
+    // record is overwritten, so raise the capacity if this ever prints
+    // ------------------------------------------------------------------------
+    unsigned int Push(const Record& record)
+    {
+        if (count == capacity)
+        {
+            std::cout << "ERROR::FRAME_RING::FULL " << capacity << std::endl;
+            count--;
+        }
+        unsigned int index = frame * capacity + count++;
+        if (records)
+            records[index] = record;
+        return index;
+    }
+
+    // fences the section, call once every draw reading this frame's records is queued
+    // ------------------------------------------------------------------------
+    void EndFrame()
+    {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    unsigned int Capacity() const { return capacity; }
+    unsigned int Count() const { return count; }
+    // global index of the first record of the current frame
+    unsigned int FrameBase() const { return frame * capacity; }
+    unsigned int Buffer() const { return buffer.ID(); }
+
+private:
+    unsigned int capacity;
+    unsigned int frame;
+    unsigned int count;
+    GLBuffer buffer;
+    Record* records;
+    GLsync fences[FRAMES];
+};
+#endif
@@ -0,0 +1,154 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+// the six planes of a view frustum, normals point inside
+struct Frustum
+{
+    glm::vec4 Planes[6];
+
+    // extracts the planes from a projection * view matrix (Gribb and Hartmann)
+    static Frustum FromMatrix(const glm::mat4& viewProjection)
+    {
+        glm::mat4 m = glm::transpose(viewProjection);
+        Frustum frustum;
+        frustum.Planes[0] = m[3] + m[0];
+        frustum.Planes[1] = m[3] - m[0];
+        frustum.Planes[2] = m[3] + m[1];
+        frustum.Planes[3] = m[3] - m[1];
+        frustum.Planes[4] = m[3] + m[2];
+        frustum.Planes[5] = m[3] - m[2];
+        for (int i = 0; i < 6; i++)
+            frustum.Planes[i] /= glm::length(glm::vec3(frustum.Planes[i]));
+        return frustum;
+    }
+
+    // one box at a time, for the odd query outside a batch
+    bool Intersects(const AABB& box) const
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 normal = glm::vec3(Planes[i]);
+            float distance = glm::dot(normal, center) + Planes[i].w;
+            float radius = glm::dot(glm::abs(normal), extents);
+            if (distance + radius < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Tests a batch of world space boxes against a frustum four at a time with SSE (one at a time without SSE2). Boxes are kept as structure of arrays
+// (center and extents per axis) so each plane test is a handful of packed multiply-adds over four boxes.
+// A box is culled when it lies completely behind one plane, boxes that straddle a corner of the frustum are kept.
+class FrustumCuller
+{
+public:
+    void Clear()
+    {
+        centerX.clear(); centerY.clear(); centerZ.clear();
+        extentX.clear(); extentY.clear(); extentZ.clear();
+    }
+
+    // returns the index of the box in the batch
+    unsigned int Add(const AABB& box)
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+        extentX.push_back(extents.x); extentY.push_back(extents.y); extentZ.push_back(extents.z);
+        return (unsigned int)centerX.size() - 1;
+    }
+
+    unsigned int Count() const { return (unsigned int)centerX.size(); }
+
+    // writes 1 (visible) or 0 (culled) per box into visible and returns the number of visible boxes
+    // ------------------------------------------------------------------------
+    unsigned int Cull(const Frustum& frustum, std::vector<unsigned char>& visible)
+    {
+        unsigned int count = Count();
+#ifdef FRUSTUM_CULLER_SSE2
+        // pad to a multiple of 4 so the loop needs no scalar tail, the padding lanes are taken off again below
+        unsigned int padded = (count + 3) & ~3u;
+        for (unsigned int i = count; i < padded; i++)
+        {
+            centerX.push_back(0.0f); centerY.push_back(0.0f); centerZ.push_back(0.0f);
+            extentX.push_back(0.0f); extentY.push_back(0.0f); extentZ.push_back(0.0f);
+        }
+        visible.resize(padded);
+
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = frustum.Planes[p];
+            planeX[p] = _mm_set1_ps(plane.x); planeY[p] = _mm_set1_ps(plane.y); planeZ[p] = _mm_set1_ps(plane.z);
+            planeW[p] = _mm_set1_ps(plane.w);
+            absX[p] = _mm_set1_ps(std::abs(plane.x)); absY[p] = _mm_set1_ps(std::abs(plane.y)); absZ[p] = _mm_set1_ps(std::abs(plane.z));
+        }
+
+        unsigned int visibleCount = 0;
+        const __m128 zero = _mm_setzero_ps();
+        for (unsigned int i = 0; i < padded; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                // signed distance of the center plus the projected half size of the box onto the plane normal
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)), _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+
+        for (unsigned int i = count; i < padded; i++)
+            visibleCount -= visible[i];
+        visible.resize(count);
+        centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+        extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+#else
+        // same plane test as the SSE path, one box at a time
+        visible.resize(count);
+        unsigned int visibleCount = 0;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++)
+            {
+                const glm::vec4& plane = frustum.Planes[p];
+                float distance = (plane.x * centerX[i] + plane.y * centerY[i]) + (plane.z * centerZ[i] + plane.w);
+                float radius = (std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i]) + std::abs(plane.z) * extentZ[i];
+                inside = distance + radius >= 0.0f;
+            }
+            visible[i] = inside ? 1 : 0;
+            visibleCount += inside ? 1 : 0;
+        }
+#endif
+        return visibleCount;
+    }
+
+private:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+};
+#endif
@@ -0,0 +1,66 @@
+#ifndef GL_OBJECT_H
+#define GL_OBJECT_H
+
+#include <glad/glad.h>
+
+// Move-only owner of one GL object name, deleted together with its owner. Classes that hold GPU data keep it in these,
+// so copying one by accident is a compile error instead of a silent deep copy or a double delete.
+template <typename Traits>
+class GLObject
+{
+public:
+    GLObject() : id(0) {}
+
+    // generates a new name
+    static GLObject Create()
+    {
+        GLObject object;
+        Traits::create(1, &object.id);
+        return object;
+    }
+
+    ~GLObject() { reset(); }
+
+    GLObject(GLObject&& other) noexcept : id(other.id) { other.id = 0; }
+    GLObject& operator=(GLObject&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    GLObject(const GLObject&) = delete;
+    GLObject& operator=(const GLObject&) = delete;
+
+    unsigned int ID() const { return id; }
+
+private:
+    unsigned int id;
+
+    void reset()
+    {
+        if (id)
+            Traits::destroy(1, &id);
+        id = 0;
+    }
+};
+
+struct GLBufferTraits
+{
+    static void create(GLsizei count, GLuint* ids) { glGenBuffers(count, ids); }
+    static void destroy(GLsizei count, const GLuint* ids) { glDeleteBuffers(count, ids); }
+};
+
+struct GLVertexArrayTraits
+{
+    static void create(GLsizei count, GLuint* ids) { glGenVertexArrays(count, ids); }
+    static void destroy(GLsizei count, const GLuint* ids) { glDeleteVertexArrays(count, ids); }
+};
+
+typedef GLObject<GLBufferTraits> GLBuffer;
+typedef GLObject<GLVertexArrayTraits> GLVertexArray;
+#endif
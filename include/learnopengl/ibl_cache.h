@@ -0,0 +1,321 @@
+#ifndef IBL_CACHE_H
+#define IBL_CACHE_H
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+
+#include <learnopengl/ibl_cpu_baker.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// Everything that changes the output of the IBL precompute besides the HDR itself and the bake shaders.
+// All of it takes part in the cache key, so changing a size here invalidates old caches automatically.
+struct IBLBakeParams
+{
+    unsigned int envSize = 512;
+    unsigned int irradianceSize = 32;
+    unsigned int prefilterSize = 128;
+    unsigned int prefilterMips = 5;
+    // 1 when irradiance and prefilter come from IBLCpuBaker, the results differ slightly from the fragment passes
+    unsigned int cpuConvolution = 0;
+    // 1 when diffuse irradiance comes from spherical harmonics and no irradiance cubemap is baked
+    unsigned int shIrradiance = 0;
+    // 1 when the GPU bake runs the compute shaders of IBLComputeBaker instead of the raster passes
+    unsigned int computeBake = 0;
+};
+
+// Persists the baked IBL textures (environment cubemap, irradiance and prefilter) to a single binary file
+// next to the source HDR. The file is keyed by a hash of the HDR bytes, the bake shaders and the bake parameters,
+// so a stale cache is simply rebaked and overwritten. A texture that was not baked (0) is stored as empty and loads as 0.
+class IBLCache
+{
+public:
+    uint64_t Key;
+    std::string CachePath;
+    IBLBakeParams Params;
+
+    // constructor, hashes the inputs of the bake. shaderPaths are the programs used by the bake.
+    // ------------------------------------------------------------------------
+    IBLCache(const std::string& hdrPath, const IBLBakeParams& params, const std::vector<std::string>& shaderPaths)
+        : Key(FNV_OFFSET), CachePath(hdrPath + ".iblcache"), Params(params)
+    {
+        Key = hashFile(hdrPath, Key);
+        for (unsigned int i = 0; i < shaderPaths.size(); i++)
+            Key = hashFile(shaderPaths[i], Key);
+        Key = hashBytes(&params, sizeof(IBLBakeParams), Key);
+        uint32_t version = VERSION;
+        Key = hashBytes(&version, sizeof(version), Key);
+    }
+
+    // loads all three textures from the cache file. returns false (and creates nothing) on a miss or a damaged file.
+    // ------------------------------------------------------------------------
+    bool Load(unsigned int& envCubemap, unsigned int& irradianceMap, unsigned int& prefilterMap)
+    {
+        std::ifstream file(CachePath, std::ios::binary);
+        if (!file)
+            return false;
+
+        uint64_t key = 0;
+        IBLBakeParams params;
+        if (!readFileHeader(file, key, params) || key != Key)
+            return false;
+
+        unsigned int textures[3] = { 0, 0, 0 };
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            if (!readTexture(file, textures[i]))
+            {
+                std::cout << "ERROR::IBL_CACHE::DAMAGED_FILE " << CachePath << std::endl;
+                glDeleteTextures(3, textures);
+                return false;
+            }
+        }
+        envCubemap = textures[0];
+        irradianceMap = textures[1];
+        prefilterMap = textures[2];
+        return true;
+    }
+
+    // reads every mip of the baked textures back from the GPU and writes them out. a temp file is renamed over the
+    // old cache at the end, so an interrupted write never leaves a half-written cache behind.
+    // ------------------------------------------------------------------------
+    void Save(unsigned int envCubemap, unsigned int irradianceMap, unsigned int prefilterMap)
+    {
+        std::string tempPath = CachePath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                std::cout << "ERROR::IBL_CACHE::CANNOT_WRITE " << tempPath << std::endl;
+                return;
+            }
+            uint32_t magic = MAGIC, version = VERSION;
+            file.write((const char*)&magic, sizeof(magic));
+            file.write((const char*)&version, sizeof(version));
+            file.write((const char*)&Key, sizeof(Key));
+            file.write((const char*)&Params, sizeof(Params));
+
+            writeTexture(file, GL_TEXTURE_CUBE_MAP, envCubemap, GL_RGB16F, GL_RGB);
+            writeTexture(file, GL_TEXTURE_CUBE_MAP, irradianceMap, GL_RGB16F, GL_RGB);
+            writeTexture(file, GL_TEXTURE_CUBE_MAP, prefilterMap, GL_RGB16F, GL_RGB);
+            if (!file)
+            {
+                std::cout << "ERROR::IBL_CACHE::CANNOT_WRITE " << tempPath << std::endl;
+                return;
+            }
+        }
+        std::remove(CachePath.c_str());
+        std::rename(tempPath.c_str(), CachePath.c_str());
+    }
+
+    // reads the textures of a cache file into system memory, without a GL context and without checking the key, so
+    // offline tools can compare a bake against it. params tells how it was baked, a texture that was not baked stays empty
+    // ------------------------------------------------------------------------
+    static bool ReadTexels(const std::string& path, IBLBakeParams& params, CpuCubemap& envCubemap, CpuCubemap& irradianceMap, CpuCubemap& prefilterMap)
+    {
+        std::ifstream file(path, std::ios::binary);
+        uint64_t key = 0;
+        if (!file || !readFileHeader(file, key, params))
+            return false;
+        CpuCubemap* cubemaps[3] = { &envCubemap, &irradianceMap, &prefilterMap };
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            if (!readTexels(file, *cubemaps[i]))
+            {
+                std::cout << "ERROR::IBL_CACHE::DAMAGED_FILE " << path << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x4342494C; // "LIBC"
+    static const uint32_t VERSION = 4;
+    static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    // per-texture header, followed by faces * mips blobs of half float texels (face-major inside each mip)
+    struct TextureHeader
+    {
+        uint32_t target;
+        uint32_t internalFormat;
+        uint32_t format;
+        uint32_t size;
+        uint32_t mips;
+        uint32_t minFilter;
+    };
+
+    static bool readFileHeader(std::ifstream& file, uint64_t& key, IBLBakeParams& params)
+    {
+        uint32_t magic = 0, version = 0;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&key, sizeof(key));
+        file.read((char*)&params, sizeof(params));
+        return file && magic == MAGIC && version == VERSION;
+    }
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    static uint64_t hashFile(const std::string& path, uint64_t hash)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            // still produce a key, it just won't match a cache written while the file existed
+            std::cout << "ERROR::IBL_CACHE::CANNOT_HASH " << path << std::endl;
+            return hashBytes(path.data(), path.size(), hash);
+        }
+        std::vector<char> buffer(1 << 16);
+        while (file)
+        {
+            file.read(buffer.data(), buffer.size());
+            hash = hashBytes(buffer.data(), (size_t)file.gcount(), hash);
+        }
+        return hash;
+    }
+
+    static unsigned int componentCount(GLenum format)
+    {
+        return format == GL_RG ? 2 : 3;
+    }
+
+    void writeTexture(std::ofstream& file, GLenum target, unsigned int texture, GLenum internalFormat, GLenum format)
+    {
+        if (texture == 0)
+        {
+            TextureHeader empty = { target, internalFormat, format, 0, 0, 0 };
+            file.write((const char*)&empty, sizeof(empty));
+            return;
+        }
+        glBindTexture(target, texture);
+        GLenum levelTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+        GLint size = 0, minFilter = 0, maxLevel = 0;
+        glGetTexLevelParameteriv(levelTarget, 0, GL_TEXTURE_WIDTH, &size);
+        glGetTexParameteriv(target, GL_TEXTURE_MIN_FILTER, &minFilter);
+        glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+        // only textures sampled with mipmaps need their chain, up to the last level the texture has
+        uint32_t mips = 1;
+        if (minFilter != GL_LINEAR && minFilter != GL_NEAREST)
+            while ((size >> mips) > 0 && (GLint)mips <= maxLevel)
+                mips++;
+
+        TextureHeader header = { target, internalFormat, format, (uint32_t)size, mips, (uint32_t)minFilter };
+        file.write((const char*)&header, sizeof(header));
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        unsigned int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        std::vector<uint16_t> pixels;
+        for (uint32_t mip = 0; mip < mips; mip++)
+        {
+            unsigned int mipSize = (unsigned int)size >> mip;
+            pixels.resize(mipSize * mipSize * componentCount(format));
+            for (unsigned int face = 0; face < faces; face++)
+            {
+                glGetTexImage(levelTarget + face, mip, format, GL_HALF_FLOAT, pixels.data());
+                file.write((const char*)pixels.data(), pixels.size() * sizeof(uint16_t));
+            }
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+
+    // false for a damaged header, a texture that was not baked has size and mips 0
+    static bool readTextureHeader(std::ifstream& file, TextureHeader& header)
+    {
+        file.read((char*)&header, sizeof(header));
+        if (!file)
+            return false;
+        if (header.size == 0 && header.mips == 0)
+            return true;
+        return header.size != 0 && header.mips != 0 && header.mips <= 16;
+    }
+
+    bool readTexture(std::ifstream& file, unsigned int& texture)
+    {
+        texture = 0;
+        TextureHeader header;
+        if (!readTextureHeader(file, header))
+            return false;
+        if (header.size == 0)
+            return true;
+
+        glGenTextures(1, &texture);
+        glBindTexture(header.target, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        GLenum levelTarget = header.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : header.target;
+        unsigned int faces = header.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        std::vector<uint16_t> pixels;
+        for (uint32_t mip = 0; mip < header.mips; mip++)
+        {
+            unsigned int mipSize = header.size >> mip;
+            pixels.resize(mipSize * mipSize * componentCount(header.format));
+            for (unsigned int face = 0; face < faces; face++)
+            {
+                file.read((char*)pixels.data(), pixels.size() * sizeof(uint16_t));
+                if (!file)
+                {
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                    glDeleteTextures(1, &texture);
+                    texture = 0;
+                    return false;
+                }
+                glTexImage2D(levelTarget + face, mip, header.internalFormat, mipSize, mipSize, 0, header.format, GL_HALF_FLOAT, pixels.data());
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(header.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(header.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (header.target == GL_TEXTURE_CUBE_MAP)
+            glTexParameteri(header.target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(header.target, GL_TEXTURE_MIN_FILTER, header.minFilter);
+        glTexParameteri(header.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(header.target, GL_TEXTURE_MAX_LEVEL, header.mips - 1);
+        return true;
+    }
+
+    // the half float texels of an RGB cubemap, which is already the face-major layout of CpuCubemap
+    static bool readTexels(std::ifstream& file, CpuCubemap& cubemap)
+    {
+        cubemap = CpuCubemap();
+        TextureHeader header;
+        if (!readTextureHeader(file, header))
+            return false;
+        if (header.size == 0)
+            return true;
+        if (header.target != GL_TEXTURE_CUBE_MAP || header.format != GL_RGB)
+            return false;
+
+        cubemap.Allocate(header.size, header.mips);
+        std::vector<uint16_t> pixels;
+        for (uint32_t mip = 0; mip < header.mips; mip++)
+        {
+            std::vector<float>& level = cubemap.levels[mip];
+            pixels.resize(level.size());
+            file.read((char*)pixels.data(), pixels.size() * sizeof(uint16_t));
+            if (!file)
+                return false;
+            for (size_t i = 0; i < pixels.size(); i++)
+                level[i] = glm::unpackHalf1x16(pixels[i]);
+        }
+        return true;
+    }
+};
+#endif
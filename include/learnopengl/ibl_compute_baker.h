@@ -0,0 +1,188 @@
+#ifndef IBL_COMPUTE_BAKER_H
+#define IBL_COMPUTE_BAKER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/ibl_cpu_baker.h>
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Compute shader implementation of the IBL bake. Every pass writes its cubemap (or the brdf lut) directly with
+// imageStore, one 8x8 work group per tile of a face and the face in gl_WorkGroupID.z, so there is no framebuffer,
+// depth buffer, viewport or cube mesh involved. The convolutions share their sample set across a work group:
+// the samples are built 64 at a time into shared memory, then every invocation rotates the tile into its own frame.
+// Textures are RGBA16F with immutable storage, the only float format image load / store takes besides RGBA32F.
+class IBLComputeBaker
+{
+public:
+    // GPU time of the last bake, threads stays 1
+    IBLBakeStats LastStats;
+
+    // constructor
+    // ------------------------------------------------------------------------
+    IBLComputeBaker()
+    {
+        glGenQueries(1, &timer);
+    }
+
+    ~IBLComputeBaker()
+    {
+        glDeleteQueries(1, &timer);
+    }
+
+    IBLComputeBaker(const IBLComputeBaker&) = delete;
+    IBLComputeBaker& operator=(const IBLComputeBaker&) = delete;
+
+    // resamples an equirectangular HDR texture into a mip-complete cubemap
+    // ------------------------------------------------------------------------
+    unsigned int EquirectangularToCubemap(unsigned int hdrTexture, unsigned int faceSize)
+    {
+        unsigned int mips = 1;
+        while ((faceSize >> mips) > 0)
+            mips++;
+        unsigned int cubemap = allocateCubemap(faceSize, mips, GL_LINEAR_MIPMAP_LINEAR);
+
+        ComputeShader shader("equirectangular_to_cubemap.comp");
+        shader.use();
+        shader.setInt("equirectangularMap", 0);
+        shader.setInt("faceSize", faceSize);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+
+        begin(6ull * faceSize * faceSize);
+        glBindImageTexture(0, cubemap, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        dispatchFaces(faceSize);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        end();
+        return cubemap;
+    }
+
+    // cosine weighted hemisphere convolution, same sample pattern as irradiance_convolution.fs.
+    // environmentSize is the face size of the mip 0 of environment
+    // ------------------------------------------------------------------------
+    unsigned int BakeIrradiance(unsigned int environment, unsigned int environmentSize, unsigned int faceSize)
+    {
+        unsigned int irradiance = allocateCubemap(faceSize, 1, GL_LINEAR);
+
+        ComputeShader shader("irradiance_convolution.comp");
+        shader.use();
+        shader.setInt("environmentMap", 0);
+        shader.setInt("faceSize", faceSize);
+        // the fragment pass picks its lod from screen derivatives, which is one env texel per output texel footprint
+        shader.setFloat("sourceLod", std::log2((float)environmentSize / (float)faceSize));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+
+        begin(6ull * faceSize * faceSize);
+        glBindImageTexture(0, irradiance, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        dispatchFaces(faceSize);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        end();
+        return irradiance;
+    }
+
+    // GGX importance sampled prefilter, same sample pattern and source lod selection as prefilter.fs.
+    // roughness of mip m is m / (mips - 1)
+    // ------------------------------------------------------------------------
+    unsigned int BakePrefilter(unsigned int environment, unsigned int environmentSize, unsigned int faceSize, unsigned int mips)
+    {
+        unsigned int prefilter = allocateCubemap(faceSize, mips, GL_LINEAR_MIPMAP_LINEAR);
+
+        ComputeShader shader("prefilter.comp");
+        shader.use();
+        shader.setInt("environmentMap", 0);
+        shader.setFloat("environmentSize", (float)environmentSize);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
+
+        unsigned long long texels = 0;
+        for (unsigned int mip = 0; mip < mips; mip++)
+            texels += 6ull * std::max(1u, faceSize >> mip) * std::max(1u, faceSize >> mip);
+        begin(texels);
+        for (unsigned int mip = 0; mip < mips; mip++)
+        {
+            unsigned int mipSize = std::max(1u, faceSize >> mip);
+            shader.setInt("faceSize", mipSize);
+            shader.setFloat("roughness", mips > 1 ? (float)mip / (float)(mips - 1) : 0.0f);
+            glBindImageTexture(0, prefilter, mip, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            dispatchFaces(mipSize);
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        end();
+        return prefilter;
+    }
+
+    // the split sum table of brdf.fs plus the multiscatter channel, read it back with BrdfLut::ReadBack(texture, samples, 3)
+    // ------------------------------------------------------------------------
+    unsigned int BakeBrdfLut(unsigned int size)
+    {
+        unsigned int lut;
+        glGenTextures(1, &lut);
+        glBindTexture(GL_TEXTURE_2D, lut);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, size, size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        ComputeShader shader("brdf.comp");
+        shader.use();
+        shader.setInt("lutSize", size);
+
+        begin((unsigned long long)size * size);
+        glBindImageTexture(0, lut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((size + GROUP_SIZE - 1) / GROUP_SIZE, (size + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        end();
+        return lut;
+    }
+
+private:
+    // keep in sync with local_size in the .comp files
+    static const unsigned int GROUP_SIZE = 8;
+
+    unsigned int timer;
+
+    static unsigned int allocateCubemap(unsigned int faceSize, unsigned int mips, GLenum minFilter)
+    {
+        unsigned int cubemap;
+        glGenTextures(1, &cubemap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, mips, GL_RGBA16F, faceSize, faceSize);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // immutable storage still reports the default max level of 1000, the cache sizes the mip chain from it
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mips - 1);
+        return cubemap;
+    }
+
+    // one work group per 8x8 tile of every face, the face is the z of the work group
+    static void dispatchFaces(unsigned int faceSize)
+    {
+        glDispatchCompute((faceSize + GROUP_SIZE - 1) / GROUP_SIZE, (faceSize + GROUP_SIZE - 1) / GROUP_SIZE, 6);
+    }
+
+    void begin(unsigned long long texels)
+    {
+        LastStats.texels = texels;
+        LastStats.threads = 1;
+        glBeginQuery(GL_TIME_ELAPSED, timer);
+    }
+
+    // waits for the GPU, the bake runs once at startup so the stall does not matter
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &nanoseconds);
+        LastStats.seconds = (double)nanoseconds * 1e-9;
+    }
+};
+#endif
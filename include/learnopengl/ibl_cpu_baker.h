@@ -0,0 +1,509 @@
+#ifndef IBL_CPU_BAKER_H
+#define IBL_CPU_BAKER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IBL_CPU_BAKER_SSE2
+#include <emmintrin.h>
+#endif
+
+// A cubemap held in system memory: RGB float texels, one vector per mip, the six faces stored one after another
+// in GL face order (+X, -X, +Y, -Y, +Z, -Z) with row 0 at t = 0, i.e. exactly what glTexImage2D expects.
+struct CpuCubemap
+{
+    unsigned int size = 0;
+    std::vector<std::vector<float>> levels;
+
+    unsigned int Mips() const { return (unsigned int)levels.size(); }
+    unsigned int MipSize(unsigned int mip) const { return std::max(1u, size >> mip); }
+
+    float* Texel(unsigned int mip, unsigned int face, unsigned int x, unsigned int y)
+    {
+        unsigned int s = MipSize(mip);
+        return &levels[mip][((face * s + y) * s + x) * 3];
+    }
+    const float* Texel(unsigned int mip, unsigned int face, unsigned int x, unsigned int y) const
+    {
+        unsigned int s = MipSize(mip);
+        return &levels[mip][((face * s + y) * s + x) * 3];
+    }
+
+    void Allocate(unsigned int faceSize, unsigned int mips)
+    {
+        size = faceSize;
+        levels.resize(mips);
+        for (unsigned int mip = 0; mip < mips; mip++)
+            levels[mip].assign(6 * MipSize(mip) * MipSize(mip) * 3, 0.0f);
+    }
+
+    // uploads every level as RGB16F, the same storage the GPU bake renders into
+    // ------------------------------------------------------------------------
+    unsigned int Upload(GLenum minFilter) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        for (unsigned int mip = 0; mip < Mips(); mip++)
+        {
+            unsigned int s = MipSize(mip);
+            for (unsigned int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB16F, s, s, 0, GL_RGB, GL_FLOAT, Texel(mip, face, 0, 0));
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, Mips() - 1);
+        return texture;
+    }
+};
+
+// Throughput of the last bake, texels written per second per worker thread is the number to compare across machines.
+struct IBLBakeStats
+{
+    unsigned long long texels = 0;
+    double seconds = 0.0;
+    unsigned int threads = 1;
+
+    double TexelsPerSecondPerCore() const
+    {
+        return seconds > 0.0 ? (double)texels / seconds / (double)threads : 0.0;
+    }
+};
+
+// CPU implementation of equirectangular_to_cubemap.fs, irradiance_convolution.fs and prefilter.fs, for machines
+// without a GPU and for checking the GPU bake. Cube faces are split into tiles that are spread over a thread pool.
+//
+// Both convolutions only depend on the output direction through the tangent frame (V == N for the prefilter), so
+// the Hammersley/GGX sample set is built once per roughness in tangent space. The per-texel loop then rotates 4
+// samples at a time into world space and picks their cube face and uv with SSE2; only the texel fetch is scalar.
+class IBLCpuBaker
+{
+public:
+    IBLBakeStats LastStats;
+
+    // constructor, 0 threads means one per hardware thread
+    // ------------------------------------------------------------------------
+    explicit IBLCpuBaker(unsigned int threadCount = 0) : pool(threadCount)
+    {
+    }
+
+    // resamples an equirectangular HDR (as returned by stbi_loadf with flip on) into a mip-complete cubemap
+    // ------------------------------------------------------------------------
+    CpuCubemap EquirectangularToCubemap(const float* data, int width, int height, int components, unsigned int faceSize)
+    {
+        CpuCubemap cubemap;
+        unsigned int mips = 1;
+        while ((faceSize >> mips) > 0)
+            mips++;
+        cubemap.Allocate(faceSize, mips);
+
+        beginStats(6ull * faceSize * faceSize);
+        forEachTile(faceSize, [&](unsigned int face, unsigned int x, unsigned int y)
+        {
+            glm::vec3 dir = glm::normalize(faceDirection(face, x, y, faceSize));
+            // same mapping as SampleSphericalMap in equirectangular_to_cubemap.fs
+            float u = std::atan2(dir.z, dir.x) * 0.1591f + 0.5f;
+            float v = std::asin(dir.y) * 0.3183f + 0.5f;
+            sampleEquirectangular(data, width, height, components, u, v, cubemap.Texel(0, face, x, y));
+        });
+        endStats();
+
+        for (unsigned int mip = 1; mip < mips; mip++)
+            downsample(cubemap, mip);
+        return cubemap;
+    }
+
+    // cosine weighted hemisphere convolution, same sample pattern as irradiance_convolution.fs
+    // ------------------------------------------------------------------------
+    CpuCubemap BakeIrradiance(const CpuCubemap& environment, unsigned int faceSize)
+    {
+        const float PI = 3.14159265359f;
+        const float sampleDelta = 0.025f;
+        SampleSet samples;
+        for (float phi = 0.0f; phi < 2.0f * PI; phi += sampleDelta)
+        {
+            for (float theta = 0.0f; theta < 0.5f * PI; theta += sampleDelta)
+                samples.Add(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta), std::cos(theta) * std::sin(theta), 0.0f);
+        }
+        samples.Pad();
+        // the GPU pass picks its lod from screen derivatives, which is one env texel per output texel footprint
+        float lod = std::log2((float)environment.size / (float)faceSize);
+        for (unsigned int i = 0; i < samples.lod.size(); i++)
+            samples.lod[i] = lod;
+
+        CpuCubemap irradiance;
+        irradiance.Allocate(faceSize, 1);
+        float scale = PI / (float)samples.count;
+
+        beginStats(6ull * faceSize * faceSize);
+        forEachTile(faceSize, [&](unsigned int face, unsigned int x, unsigned int y)
+        {
+            glm::vec3 N = glm::normalize(faceDirection(face, x, y, faceSize));
+            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::vec3 right = glm::cross(up, N);
+            right = glm::length(right) > 1e-4f ? glm::normalize(right) : glm::vec3(1.0f, 0.0f, 0.0f);
+            up = glm::cross(N, right);
+
+            glm::vec3 sum = convolve(environment, samples, right, up, N);
+            float* out = irradiance.Texel(0, face, x, y);
+            out[0] = sum.r * scale;
+            out[1] = sum.g * scale;
+            out[2] = sum.b * scale;
+        });
+        endStats();
+        return irradiance;
+    }
+
+    // GGX importance sampled prefilter, same sample pattern and source lod selection as prefilter.fs.
+    // roughness of mip m is m / (mips - 1).
+    // ------------------------------------------------------------------------
+    CpuCubemap BakePrefilter(const CpuCubemap& environment, unsigned int faceSize, unsigned int mips, unsigned int sampleCount = 1024)
+    {
+        CpuCubemap prefilter;
+        prefilter.Allocate(faceSize, mips);
+
+        unsigned long long texels = 0;
+        for (unsigned int mip = 0; mip < mips; mip++)
+            texels += 6ull * prefilter.MipSize(mip) * prefilter.MipSize(mip);
+
+        beginStats(texels);
+        for (unsigned int mip = 0; mip < mips; mip++)
+        {
+            float roughness = mips > 1 ? (float)mip / (float)(mips - 1) : 0.0f;
+            SampleSet samples = ggxSamples(roughness, sampleCount, environment.size);
+            unsigned int mipSize = prefilter.MipSize(mip);
+            forEachTile(mipSize, [&](unsigned int face, unsigned int x, unsigned int y)
+            {
+                glm::vec3 N = glm::normalize(faceDirection(face, x, y, mipSize));
+                glm::vec3 up = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                glm::vec3 tangent = glm::normalize(glm::cross(up, N));
+                glm::vec3 bitangent = glm::cross(N, tangent);
+
+                glm::vec3 sum = convolve(environment, samples, tangent, bitangent, N);
+                float* out = prefilter.Texel(mip, face, x, y);
+                float inverseWeight = samples.totalWeight > 0.0f ? 1.0f / samples.totalWeight : 0.0f;
+                out[0] = sum.r * inverseWeight;
+                out[1] = sum.g * inverseWeight;
+                out[2] = sum.b * inverseWeight;
+            });
+        }
+        endStats();
+        return prefilter;
+    }
+
+private:
+    static const unsigned int TILE = 16;
+
+    ThreadPool pool;
+    std::chrono::high_resolution_clock::time_point statsStart;
+
+    // tangent space samples in SoA layout, padded to a multiple of 4 with zero weight
+    struct SampleSet
+    {
+        std::vector<float> x, y, z, weight, lod;
+        unsigned int count = 0;
+        float totalWeight = 0.0f;
+
+        void Add(float sx, float sy, float sz, float w, float l)
+        {
+            x.push_back(sx); y.push_back(sy); z.push_back(sz); weight.push_back(w); lod.push_back(l);
+            count++;
+            totalWeight += w;
+        }
+        void Pad()
+        {
+            while (x.size() % 4 != 0)
+            {
+                x.push_back(0.0f); y.push_back(0.0f); z.push_back(1.0f); weight.push_back(0.0f); lod.push_back(0.0f);
+            }
+        }
+    };
+
+    void beginStats(unsigned long long texels)
+    {
+        LastStats.texels = texels;
+        LastStats.threads = pool.Size();
+        statsStart = std::chrono::high_resolution_clock::now();
+    }
+
+    void endStats()
+    {
+        LastStats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - statsStart).count();
+    }
+
+    // splits every face into TILE x TILE blocks and runs body once per texel across the pool
+    template <typename F>
+    void forEachTile(unsigned int faceSize, const F& body)
+    {
+        unsigned int tilesPerRow = (faceSize + TILE - 1) / TILE;
+        unsigned int tilesPerFace = tilesPerRow * tilesPerRow;
+        pool.ParallelFor(6 * tilesPerFace, [&](unsigned int tile)
+        {
+            unsigned int face = tile / tilesPerFace;
+            unsigned int tx = (tile % tilesPerFace) % tilesPerRow * TILE;
+            unsigned int ty = (tile % tilesPerFace) / tilesPerRow * TILE;
+            for (unsigned int y = ty; y < std::min(ty + TILE, faceSize); y++)
+                for (unsigned int x = tx; x < std::min(tx + TILE, faceSize); x++)
+                    body(face, x, y);
+        });
+    }
+
+    // direction through the centre of texel (x, y) of a face, per the GL cube map face table
+    static glm::vec3 faceDirection(unsigned int face, unsigned int x, unsigned int y, unsigned int faceSize)
+    {
+        float s = 2.0f * ((float)x + 0.5f) / (float)faceSize - 1.0f;
+        float t = 2.0f * ((float)y + 0.5f) / (float)faceSize - 1.0f;
+        switch (face)
+        {
+        case 0: return glm::vec3(1.0f, -t, -s);
+        case 1: return glm::vec3(-1.0f, -t, s);
+        case 2: return glm::vec3(s, 1.0f, t);
+        case 3: return glm::vec3(s, -1.0f, -t);
+        case 4: return glm::vec3(s, -t, 1.0f);
+        default: return glm::vec3(-s, -t, -1.0f);
+        }
+    }
+
+    // inverse of faceDirection: picks the major axis and returns the face and its [0, 1] uv
+    static void directionToFace(float x, float y, float z, unsigned int& face, float& u, float& v)
+    {
+        float ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+        float ma, sc, tc;
+        if (ax >= ay && ax >= az)
+        {
+            ma = ax; face = x > 0.0f ? 0 : 1;
+            sc = x > 0.0f ? -z : z; tc = -y;
+        }
+        else if (ay >= az)
+        {
+            ma = ay; face = y > 0.0f ? 2 : 3;
+            sc = x; tc = y > 0.0f ? z : -z;
+        }
+        else
+        {
+            ma = az; face = z > 0.0f ? 4 : 5;
+            sc = z > 0.0f ? x : -x; tc = -y;
+        }
+        float inverse = ma > 0.0f ? 0.5f / ma : 0.0f;
+        u = sc * inverse + 0.5f;
+        v = tc * inverse + 0.5f;
+    }
+
+    static void sampleFace(const CpuCubemap& cubemap, unsigned int mip, unsigned int face, float u, float v, float* out)
+    {
+        unsigned int s = cubemap.MipSize(mip);
+        float fx = std::min(std::max(u * s - 0.5f, 0.0f), (float)(s - 1));
+        float fy = std::min(std::max(v * s - 0.5f, 0.0f), (float)(s - 1));
+        unsigned int x0 = (unsigned int)fx, y0 = (unsigned int)fy;
+        unsigned int x1 = std::min(x0 + 1, s - 1), y1 = std::min(y0 + 1, s - 1);
+        float ax = fx - x0, ay = fy - y0;
+        const float* t00 = cubemap.Texel(mip, face, x0, y0);
+        const float* t10 = cubemap.Texel(mip, face, x1, y0);
+        const float* t01 = cubemap.Texel(mip, face, x0, y1);
+        const float* t11 = cubemap.Texel(mip, face, x1, y1);
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            float top = t00[c] + (t10[c] - t00[c]) * ax;
+            float bottom = t01[c] + (t11[c] - t01[c]) * ax;
+            out[c] = top + (bottom - top) * ay;
+        }
+    }
+
+    // trilinear fetch, lod clamped to the available chain
+    static void sampleLod(const CpuCubemap& cubemap, unsigned int face, float u, float v, float lod, float* out)
+    {
+        lod = std::min(std::max(lod, 0.0f), (float)(cubemap.Mips() - 1));
+        unsigned int mip0 = (unsigned int)lod;
+        unsigned int mip1 = std::min(mip0 + 1, cubemap.Mips() - 1);
+        float blend = lod - mip0;
+        sampleFace(cubemap, mip0, face, u, v, out);
+        if (blend > 0.0f && mip1 != mip0)
+        {
+            float upper[3];
+            sampleFace(cubemap, mip1, face, u, v, upper);
+            for (unsigned int c = 0; c < 3; c++)
+                out[c] += (upper[c] - out[c]) * blend;
+        }
+    }
+
+    static void sampleEquirectangular(const float* data, int width, int height, int components, float u, float v, float* out)
+    {
+        float fx = std::min(std::max(u * width - 0.5f, 0.0f), (float)(width - 1));
+        float fy = std::min(std::max(v * height - 0.5f, 0.0f), (float)(height - 1));
+        int x0 = (int)fx, y0 = (int)fy;
+        int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+        float ax = fx - x0, ay = fy - y0;
+        for (int c = 0; c < 3; c++)
+        {
+            int channel = std::min(c, components - 1);
+            float t00 = data[(y0 * width + x0) * components + channel];
+            float t10 = data[(y0 * width + x1) * components + channel];
+            float t01 = data[(y1 * width + x0) * components + channel];
+            float t11 = data[(y1 * width + x1) * components + channel];
+            float top = t00 + (t10 - t00) * ax;
+            float bottom = t01 + (t11 - t01) * ax;
+            out[c] = top + (bottom - top) * ay;
+        }
+    }
+
+    // 2x2 box filter of the previous level, what glGenerateMipmap does for the GPU path
+    static void downsample(CpuCubemap& cubemap, unsigned int mip)
+    {
+        unsigned int s = cubemap.MipSize(mip);
+        unsigned int parent = cubemap.MipSize(mip - 1);
+        for (unsigned int face = 0; face < 6; face++)
+            for (unsigned int y = 0; y < s; y++)
+                for (unsigned int x = 0; x < s; x++)
+                {
+                    unsigned int px = std::min(2 * x + 1, parent - 1), py = std::min(2 * y + 1, parent - 1);
+                    const float* a = cubemap.Texel(mip - 1, face, 2 * x, 2 * y);
+                    const float* b = cubemap.Texel(mip - 1, face, px, 2 * y);
+                    const float* c = cubemap.Texel(mip - 1, face, 2 * x, py);
+                    const float* d = cubemap.Texel(mip - 1, face, px, py);
+                    float* out = cubemap.Texel(mip, face, x, y);
+                    for (unsigned int k = 0; k < 3; k++)
+                        out[k] = 0.25f * (a[k] + b[k] + c[k] + d[k]);
+                }
+    }
+
+    static float radicalInverse(unsigned int bits)
+    {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return float(bits) * 2.3283064365386963e-10f;
+    }
+
+    // with V == N the reflected L only depends on the tangent space half vector, so the whole
+    // Hammersley -> GGX -> reflect -> pdf -> source lod chain of prefilter.fs is folded into a table here
+    static SampleSet ggxSamples(float roughness, unsigned int sampleCount, unsigned int environmentSize)
+    {
+        const float PI = 3.14159265359f;
+        float a = roughness * roughness;
+        float a2 = a * a;
+        float saTexel = 4.0f * PI / (6.0f * environmentSize * environmentSize);
+
+        SampleSet samples;
+        for (unsigned int i = 0; i < sampleCount; i++)
+        {
+            float xi0 = (float)i / (float)sampleCount;
+            float xi1 = radicalInverse(i);
+            float phi = 2.0f * PI * xi0;
+            float cosTheta = std::sqrt((1.0f - xi1) / (1.0f + (a2 - 1.0f) * xi1));
+            float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+            float hx = std::cos(phi) * sinTheta, hy = std::sin(phi) * sinTheta, hz = cosTheta;
+
+            // L = 2 * dot(V, H) * H - V with V = (0, 0, 1)
+            float lx = 2.0f * hz * hx, ly = 2.0f * hz * hy, lz = 2.0f * hz * hz - 1.0f;
+            float NdotL = lz;
+            if (NdotL <= 0.0f)
+                continue;
+
+            float denom = hz * hz * (a2 - 1.0f) + 1.0f;
+            float D = a2 / (PI * denom * denom);
+            float pdf = D * hz / (4.0f * hz) + 0.0001f;
+            float saSample = 1.0f / ((float)sampleCount * pdf + 0.0001f);
+            float lod = roughness == 0.0f ? 0.0f : 0.5f * std::log2(saSample / saTexel);
+            samples.Add(lx, ly, lz, NdotL, lod);
+        }
+        samples.Pad();
+        return samples;
+    }
+
+    // sum of weight * env(T * s.x + B * s.y + N * s.z) over the sample set
+    static glm::vec3 convolve(const CpuCubemap& environment, const SampleSet& samples, const glm::vec3& T, const glm::vec3& B, const glm::vec3& N)
+    {
+        float sum[3] = { 0.0f, 0.0f, 0.0f };
+        float color[3];
+        unsigned int total = (unsigned int)samples.x.size();
+#ifdef IBL_CPU_BAKER_SSE2
+        const __m128 tx = _mm_set1_ps(T.x), ty = _mm_set1_ps(T.y), tz = _mm_set1_ps(T.z);
+        const __m128 bx = _mm_set1_ps(B.x), by = _mm_set1_ps(B.y), bz = _mm_set1_ps(B.z);
+        const __m128 nx = _mm_set1_ps(N.x), ny = _mm_set1_ps(N.y), nz = _mm_set1_ps(N.z);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (unsigned int i = 0; i < total; i += 4)
+        {
+            __m128 sx = _mm_loadu_ps(&samples.x[i]);
+            __m128 sy = _mm_loadu_ps(&samples.y[i]);
+            __m128 sz = _mm_loadu_ps(&samples.z[i]);
+            // rotate into world space
+            __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, sx), _mm_mul_ps(bx, sy)), _mm_mul_ps(nx, sz));
+            __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ty, sx), _mm_mul_ps(by, sy)), _mm_mul_ps(ny, sz));
+            __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tz, sx), _mm_mul_ps(bz, sy)), _mm_mul_ps(nz, sz));
+
+            // major axis selection, same rules as directionToFace
+            __m128 ax = _mm_andnot_ps(signMask, x), ay = _mm_andnot_ps(signMask, y), az = _mm_andnot_ps(signMask, z);
+            __m128 useX = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+            __m128 useY = _mm_andnot_ps(useX, _mm_cmpge_ps(ay, az));
+            __m128 useZ = _mm_andnot_ps(_mm_or_ps(useX, useY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+            __m128 positive = _mm_or_ps(_mm_and_ps(useX, _mm_cmpgt_ps(x, zero)), _mm_or_ps(_mm_and_ps(useY, _mm_cmpgt_ps(y, zero)), _mm_and_ps(useZ, _mm_cmpgt_ps(z, zero))));
+
+            __m128 ma = select(useX, ax, select(useY, ay, az));
+            __m128 negZ = _mm_xor_ps(z, signMask), negX = _mm_xor_ps(x, signMask), negY = _mm_xor_ps(y, signMask);
+            __m128 sc = select(useX, select(positive, negZ, z), select(useY, x, select(positive, x, negX)));
+            __m128 tc = select(useY, select(positive, z, negZ), negY);
+            __m128 inverse = _mm_div_ps(half, _mm_max_ps(ma, _mm_set1_ps(1e-20f)));
+            __m128 u = _mm_add_ps(_mm_mul_ps(sc, inverse), half);
+            __m128 v = _mm_add_ps(_mm_mul_ps(tc, inverse), half);
+
+            __m128i axis = _mm_or_si128(_mm_and_si128(_mm_castps_si128(useY), _mm_set1_epi32(2)), _mm_and_si128(_mm_castps_si128(useZ), _mm_set1_epi32(4)));
+            __m128i face = _mm_add_epi32(axis, _mm_andnot_si128(_mm_castps_si128(positive), _mm_set1_epi32(1)));
+
+            alignas(16) float lu[4], lv[4];
+            alignas(16) int lface[4];
+            _mm_store_ps(lu, u);
+            _mm_store_ps(lv, v);
+            _mm_store_si128((__m128i*)lface, face);
+            for (unsigned int lane = 0; lane < 4; lane++)
+            {
+                float weight = samples.weight[i + lane];
+                if (weight <= 0.0f)
+                    continue;
+                sampleLod(environment, (unsigned int)lface[lane], lu[lane], lv[lane], samples.lod[i + lane], color);
+                sum[0] += color[0] * weight;
+                sum[1] += color[1] * weight;
+                sum[2] += color[2] * weight;
+            }
+        }
+#else
+        for (unsigned int i = 0; i < total; i++)
+        {
+            float weight = samples.weight[i];
+            if (weight <= 0.0f)
+                continue;
+            glm::vec3 dir = T * samples.x[i] + B * samples.y[i] + N * samples.z[i];
+            unsigned int face;
+            float u, v;
+            directionToFace(dir.x, dir.y, dir.z, face, u, v);
+            sampleLod(environment, face, u, v, samples.lod[i], color);
+            sum[0] += color[0] * weight;
+            sum[1] += color[1] * weight;
+            sum[2] += color[2] * weight;
+        }
+#endif
+        return glm::vec3(sum[0], sum[1], sum[2]);
+    }
+
+#ifdef IBL_CPU_BAKER_SSE2
+    static __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+#endif
+};
+#endif
@@ -0,0 +1,621 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/frame_ring.h>
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/gl_object.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/meshlets.h>
+#include <learnopengl/model.h>
+#include <learnopengl/packed_vertex.h>
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+// Draws all static geometry with one glMultiDrawElementsIndirect. Every mesh is appended to one shared vertex arena and
+// one shared index arena at load time, so the whole pass needs a single VAO. Each frame, Queue() records one indirect
+// command per mesh and the world space box of that mesh. Submit() culls the boxes against the view frustum, writes the
+// commands that survive into a mapped FrameRing and issues them in one call per batch. Draws that need a different
+// program (a shader permutation) are queued under their own batch.
+// The baseInstance of a command is the object record index. pbr.vs reads it as gl_BaseInstance, just like with single draws.
+// The vertex arena holds QuantizedVertex, positions quantized against the bounds of their geometry. The object record of
+// a draw has to carry Quantization() of the geometry so pbr.vs can map them back.
+// A MeshCache is not copied into the arenas, Upload() writes its mapped streams into the buffers directly.
+// Every mesh keeps its levels of detail as ranges of the index arena. After SetView(), Queue() draws the coarsest level
+// whose error, projected at the distance of the mesh box, stays under the pixel error. Without it the full level is drawn.
+// A full level cut into meshlets is queued one command per meshlet instead, meshlets facing away from the camera of
+// SetView() are dropped right there and the rest are frustum culled with everything else. On the compute path the
+// meshlets of an instance are queued as one job instead, meshlet_cull.comp runs both tests and appends the survivors
+// to a GPU command buffer that Submit() draws with glMultiDrawElementsIndirectCount. Those never reach the counters below.
+class IndirectRenderer
+{
+public:
+    // a vertex handed to Add(), packed into the arena as a QuantizedVertex
+    struct ArenaVertex
+    {
+        glm::vec3 Position;
+        glm::vec2 TexCoords;
+        glm::vec3 Normal;
+        // xyz tangent, w bitangent sign
+        glm::vec4 Tangent;
+    };
+
+    // the layout glMultiDrawElementsIndirect reads
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // meshlet commands are written per batch on the compute path, later batches go through the CPU path
+    static const unsigned int MAX_MESHLET_BATCHES = 16;
+
+    // constructor, maxDraws is the number of meshes and meshlets that can be queued per frame. cullMeshletsOnGpu moves
+    // meshlet culling to meshlet_cull.comp
+    // ------------------------------------------------------------------------
+    IndirectRenderer(unsigned int maxDraws, bool cullMeshletsOnGpu = false)
+        : commands(maxDraws, GL_DRAW_INDIRECT_BUFFER), useCompute(cullMeshletsOnGpu)
+    {
+        if (useCompute)
+        {
+            cullShader.reset(new ComputeShader("meshlet_cull.comp"));
+            cullJobBase = cullShader->Uniform<int>("jobBase");
+            cullCones = cullShader->Uniform<int>("cullCones");
+            cullPlanes = cullShader->Uniform<glm::vec4>("frustumPlanes");
+            jobRing.reset(new FrameRing<MeshletJob>(maxDraws, GL_SHADER_STORAGE_BUFFER, 1));
+            meshletDraws = GLBuffer::Create();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshletDraws.ID());
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(MeshletCullHeader) + (GLsizeiptr)maxDraws * sizeof(DrawCommand), NULL, 0);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, meshletDraws.ID());
+        }
+    }
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // appends a triangle list and returns the id to Queue() it with. lods are ranges of meshIndices, by default all of
+    // them are the full level. only valid before Upload()
+    // ------------------------------------------------------------------------
+    unsigned int Add(const std::vector<ArenaVertex>& meshVertices, const std::vector<unsigned int>& meshIndices, const std::vector<MeshLod>& lods = std::vector<MeshLod>())
+    {
+        AABB bounds;
+        for (unsigned int i = 0; i < meshVertices.size(); i++)
+            bounds.Extend(meshVertices[i].Position);
+        Geometry geometry = { (unsigned int)ranges.size(), 1, bounds };
+        PositionQuantization quantization(bounds);
+        std::vector<QuantizedVertex> packed(meshVertices.size());
+        for (unsigned int i = 0; i < meshVertices.size(); i++)
+            packed[i] = QuantizedVertex::Pack(quantization, meshVertices[i].Position, meshVertices[i].Normal, meshVertices[i].Tangent, meshVertices[i].TexCoords);
+        if (lods.empty())
+        {
+            MeshLod full = { 0, (unsigned int)meshIndices.size(), 0.0f };
+            ranges.push_back(append(packed, meshIndices, &full, 1, bounds));
+        }
+        else
+            ranges.push_back(append(packed, meshIndices, lods.data(), (unsigned int)lods.size(), bounds));
+        geometries.push_back(geometry);
+        return (unsigned int)geometries.size() - 1;
+    }
+
+    // appends every mesh of model, they are queued together under the returned id
+    // ------------------------------------------------------------------------
+    unsigned int Add(const Model& model)
+    {
+        Geometry geometry = { (unsigned int)ranges.size(), (unsigned int)model.meshes.size(), AABB() };
+        // every mesh is quantized against the bounds of the whole model, so one object record decodes all of them
+        for (unsigned int i = 0; i < model.meshes.size(); i++)
+            geometry.bounds.Extend(model.meshes[i].Bounds);
+        PositionQuantization quantization(geometry.bounds);
+        std::vector<QuantizedVertex> packed;
+        for (unsigned int i = 0; i < model.meshes.size(); i++)
+        {
+            const Mesh& mesh = model.meshes[i];
+            packed.resize(mesh.vertices.size());
+            for (unsigned int v = 0; v < mesh.vertices.size(); v++)
+            {
+                const Vertex& vertex = mesh.vertices[v];
+                packed[v] = QuantizedVertex::Pack(quantization, vertex.Position, vertex.Normal, tangentFrame(vertex.Normal, vertex.Tangent, vertex.Bitangent), vertex.TexCoords);
+            }
+            Range range = append(packed, mesh.indices, mesh.Lods.data(), (unsigned int)mesh.Lods.size(), mesh.Bounds);
+            addMeshlets(range, mesh.Meshlets.data(), (unsigned int)mesh.Meshlets.size(), range.lods[0].FirstIndex - mesh.Lods[0].FirstIndex);
+            ranges.push_back(range);
+        }
+        geometries.push_back(geometry);
+        return (unsigned int)geometries.size() - 1;
+    }
+
+    // appends every mesh of a loaded cache, queued together under the returned id. the cache has to stay loaded
+    // until Upload(), its streams are read from the mapping then
+    // ------------------------------------------------------------------------
+    unsigned int Add(const MeshCache& cache)
+    {
+        // the cache quantized its stream against the same bounds
+        const MeshCache::Header& info = cache.Info();
+        Geometry geometry = { (unsigned int)ranges.size(), info.MeshCount, info.Bounds };
+        const MeshCache::MeshRecord* records = cache.Meshes();
+        for (unsigned int i = 0; i < info.MeshCount; i++)
+        {
+            const MeshCache::MeshRecord& record = records[i];
+            Range range = { (GLint)(arenaVertexCount + record.FirstVertex), record.Bounds, record.LodCount, {}, 0, 0 };
+            for (unsigned int l = 0; l < record.LodCount; l++)
+            {
+                MeshLod lod = { arenaIndexCount + record.FirstIndex + record.Lods[l].FirstIndex, record.Lods[l].IndexCount, record.Lods[l].Error };
+                range.lods[l] = lod;
+            }
+            addMeshlets(range, cache.Meshlets() + record.FirstMeshlet, record.MeshletCount, arenaIndexCount + record.FirstIndex);
+            ranges.push_back(range);
+        }
+        Chunk chunk = { cache.Vertices(), cache.Indices(), 0, 0, arenaVertexCount, info.VertexCount, arenaIndexCount, info.IndexCount };
+        chunks.push_back(chunk);
+        arenaVertexCount += info.VertexCount;
+        arenaIndexCount += info.IndexCount;
+        geometries.push_back(geometry);
+        return (unsigned int)geometries.size() - 1;
+    }
+
+    // object space bounds of all meshes of a geometry
+    const AABB& Bounds(unsigned int geometry) const { return geometries[geometry].bounds; }
+    // maps the arena positions of a geometry back to object space, goes into its object records
+    PositionQuantization Quantization(unsigned int geometry) const { return PositionQuantization(geometries[geometry].bounds); }
+
+    // moves both arenas into immutable GPU buffers and frees the CPU copies. every chunk is written where it lives in
+    // the arenas, straight from the vectors or from the mapping of its cache
+    // ------------------------------------------------------------------------
+    void Upload()
+    {
+        VAO = GLVertexArray::Create();
+        VBO = GLBuffer::Create();
+        EBO = GLBuffer::Create();
+
+        glBindVertexArray(VAO.ID());
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.ID());
+        glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)arenaVertexCount * sizeof(QuantizedVertex), NULL, GL_DYNAMIC_STORAGE_BIT);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.ID());
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)arenaIndexCount * sizeof(unsigned int), NULL, GL_DYNAMIC_STORAGE_BIT);
+        for (unsigned int i = 0; i < chunks.size(); i++)
+        {
+            const Chunk& chunk = chunks[i];
+            const QuantizedVertex* chunkVertices = chunk.mappedVertices ? chunk.mappedVertices : vertices.data() + chunk.ownedVertex;
+            const unsigned int* chunkIndices = chunk.mappedIndices ? chunk.mappedIndices : indices.data() + chunk.ownedIndex;
+            if (chunk.vertexCount > 0)
+                glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)chunk.firstVertex * sizeof(QuantizedVertex), (GLsizeiptr)chunk.vertexCount * sizeof(QuantizedVertex), chunkVertices);
+            if (chunk.indexCount > 0)
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)chunk.firstIndex * sizeof(unsigned int), (GLsizeiptr)chunk.indexCount * sizeof(unsigned int), chunkIndices);
+        }
+
+        // the attributes of pbr.vs: unorm16 position, half texCoords, octahedral snorm16 normal and tangent
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, TexCoords));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Normal));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Tangent));
+        glBindVertexArray(0);
+
+        std::vector<QuantizedVertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+        std::vector<Chunk>().swap(chunks);
+
+        // the compute path reads the meshlets from binding 0, the CPU path keeps them
+        if (useCompute && !meshlets.empty())
+        {
+            meshletBuffer = GLBuffer::Create();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshletBuffer.ID());
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)meshlets.size() * sizeof(MeshletRecord), meshlets.data(), 0);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, meshletBuffer.ID());
+        }
+    }
+
+    // the camera levels of detail are picked for and meshlets are tested against until the next call. fovY in radians,
+    // viewportHeight in pixels, a level is good enough while its error covers at most pixelError pixels on screen
+    // ------------------------------------------------------------------------
+    void SetView(const glm::vec3& cameraPosition, float fovY, float viewportHeight, float pixelError = 1.0f)
+    {
+        viewCamera = cameraPosition;
+        // pixels per world unit at distance 1, over the allowed error
+        lodScale = viewportHeight / (2.0f * std::tan(fovY * 0.5f)) / std::max(pixelError, 0.001f);
+    }
+
+    // turns the back face test of meshlets on or off, off by default. it only hides surfaces of closed meshes, with
+    // GL_CULL_FACE off the back faces of open ones are visible and would go too
+    // ------------------------------------------------------------------------
+    void SetConeCulling(bool enabled)
+    {
+        coneCulling = enabled;
+    }
+
+    // queues every mesh of geometry for this frame, drawn with the object record objectIndex. model places the
+    // mesh bounds in the world for culling and level selection, and should match the model matrix of the record
+    // ------------------------------------------------------------------------
+    void Queue(unsigned int geometry, unsigned int objectIndex, const glm::mat4& model, unsigned int batch = 0)
+    {
+        batchCount = std::max(batchCount, batch + 1);
+        const Geometry& entry = geometries[geometry];
+        // object space errors and meshlet spheres grow with the largest scale of the instance
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        // meshlet cones are tested in object space, the camera moves there once per instance
+        bool cameraMoved = false;
+        glm::vec3 camera;
+        for (unsigned int i = 0; i < entry.rangeCount; i++)
+        {
+            const Range& range = ranges[entry.firstRange + i];
+            AABB box = range.bounds.Transformed(model);
+            unsigned int level = selectLod(range, box, scale);
+            if (level == 0 && range.meshletCount > 0)
+            {
+                if (!cameraMoved)
+                {
+                    camera = glm::vec3(glm::inverse(model) * glm::vec4(viewCamera, 1.0f));
+                    cameraMoved = true;
+                }
+                queueMeshlets(range, objectIndex, model, scale, camera, batch);
+                continue;
+            }
+            const MeshLod& lod = range.lods[level];
+            DrawCommand command = { lod.IndexCount, 1, lod.FirstIndex, range.baseVertex, objectIndex };
+            queued.push_back(command);
+            queuedBatches.push_back(batch);
+            culler.Add(box);
+        }
+    }
+
+    // draws everything queued since the last Submit() that touches frustum with one call
+    // ------------------------------------------------------------------------
+    void Submit(const Frustum& frustum)
+    {
+        Submit(frustum, [](unsigned int) {});
+    }
+
+    // the same with one call per batch, bind(batch) runs before each of them to switch programs
+    // ------------------------------------------------------------------------
+    template <typename BindBatch>
+    void Submit(const Frustum& frustum, BindBatch bind)
+    {
+        backfacingCount = queuedBackfacing;
+        queuedBackfacing = 0;
+        // the meshlet jobs first, their commands have to be written before any batch is drawn
+        bool gpuMeshlets = useCompute && !queuedJobs.empty();
+        if (gpuMeshlets)
+            cullMeshlets(frustum);
+
+        visibleCount = culler.Cull(frustum, visible);
+        culledCount = (unsigned int)queued.size() - visibleCount;
+        culler.Clear();
+        unsigned int drawCount = std::min(visibleCount, commands.Capacity());
+        if (visibleCount > commands.Capacity())
+            std::cout << "ERROR::INDIRECT_RENDERER::TOO_MANY_DRAWS " << visibleCount << std::endl;
+
+        // counting sort of the visible commands by batch, every batch becomes one run of the ring
+        batchStarts.assign(batchCount + 1, 0);
+        for (unsigned int i = 0, kept = 0; i < queued.size(); i++)
+        {
+            if (visible[i] && kept++ < drawCount)
+                batchStarts[queuedBatches[i] + 1]++;
+            else
+                visible[i] = 0;
+        }
+        for (unsigned int b = 0; b < batchCount; b++)
+            batchStarts[b + 1] += batchStarts[b];
+        ordered.resize(drawCount);
+        triangleCount = 0;
+        for (unsigned int i = 0; i < queued.size(); i++)
+            if (visible[i])
+            {
+                ordered[batchStarts[queuedBatches[i]]++] = queued[i];
+                triangleCount += queued[i].count / 3;
+            }
+        queued.clear();
+        queuedBatches.clear();
+        if (drawCount == 0 && !gpuMeshlets)
+            return;
+
+        if (drawCount > 0)
+        {
+            commands.BeginFrame();
+            for (unsigned int i = 0; i < drawCount; i++)
+                commands.Push(ordered[i]);
+        }
+
+        // batchStarts now holds the end of every batch, jobStarts the end of every batch's region of meshlet commands
+        glBindVertexArray(VAO.ID());
+        unsigned int first = 0, firstJob = 0;
+        for (unsigned int b = 0; b < batchCount; b++)
+        {
+            unsigned int count = batchStarts[b] - first;
+            unsigned int meshletCapacity = gpuMeshlets && b < MAX_MESHLET_BATCHES ? jobStarts[b] - firstJob : 0;
+            if (count == 0 && meshletCapacity == 0)
+                continue;
+            bind(b);
+            if (count > 0)
+            {
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.Buffer());
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)((commands.FrameBase() + first) * sizeof(DrawCommand)), (GLsizei)count, 0);
+            }
+            if (meshletCapacity > 0)
+            {
+                // as many commands as meshlet_cull.comp counted for the batch
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, meshletDraws.ID());
+                glBindBuffer(GL_PARAMETER_BUFFER, meshletDraws.ID());
+                glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(sizeof(MeshletCullHeader) + firstJob * sizeof(DrawCommand)),
+                                                 (GLintptr)(offsetof(MeshletCullHeader, drawCounts) + b * sizeof(GLuint)), (GLsizei)meshletCapacity, 0);
+                glBindBuffer(GL_PARAMETER_BUFFER, 0);
+            }
+            first = batchStarts[b];
+            if (b < MAX_MESHLET_BATCHES && gpuMeshlets)
+                firstJob = jobStarts[b];
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+        if (drawCount > 0)
+            commands.EndFrame();
+    }
+
+    // meshes and meshlets drawn and frustum culled by the last Submit()
+    unsigned int Visible() const { return visibleCount; }
+    unsigned int Culled() const { return culledCount; }
+    // meshlets the last Submit() dropped for facing away from the camera
+    unsigned int Backfacing() const { return backfacingCount; }
+    // triangles of the levels and meshlets the last Submit() drew
+    size_t Triangles() const { return triangleCount; }
+
+private:
+    // where one mesh lives in the arenas
+    struct Range
+    {
+        GLint baseVertex;
+        // object space
+        AABB bounds;
+        // full level first, FirstIndex is in the index arena
+        unsigned int lodCount;
+        MeshLod lods[MAX_MESH_LODS];
+        // meshlets of the full level, none when it is drawn whole
+        unsigned int firstMeshlet;
+        unsigned int meshletCount;
+    };
+
+    // a Meshlet placed in the arenas, the layout meshlet_cull.comp reads
+    struct MeshletRecord
+    {
+        // object space center and radius
+        glm::vec4 sphere;
+        // axis and cutoff
+        glm::vec4 cone;
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+        GLuint padding;
+    };
+
+    // the meshlets of one queued instance for meshlet_cull.comp
+    struct MeshletJob
+    {
+        glm::mat4 model;
+        // xyz the camera in object space, w the largest scale of model
+        glm::vec4 camera;
+        GLuint firstMeshlet;
+        GLuint meshletCount;
+        GLuint objectIndex;
+        GLuint batch;
+        // where the commands of the batch start
+        GLuint outputBase;
+        GLuint padding[3];
+    };
+
+    // the start of the command buffer of the compute path, the commands follow it. only the GPU writes the buffer, the
+    // counts are cleared there every frame so the CPU never waits on the draws of the previous frame
+    struct MeshletCullHeader
+    {
+        GLuint drawCounts[MAX_MESHLET_BATCHES];
+    };
+
+    // a run of the arenas filled by Upload(), from a mapped cache or else from the owned vectors starting at ownedVertex / ownedIndex
+    struct Chunk
+    {
+        const QuantizedVertex* mappedVertices;
+        const unsigned int* mappedIndices;
+        size_t ownedVertex;
+        size_t ownedIndex;
+        GLuint firstVertex;
+        GLuint vertexCount;
+        GLuint firstIndex;
+        GLuint indexCount;
+    };
+
+    // the meshes queued under one id
+    struct Geometry
+    {
+        unsigned int firstRange;
+        unsigned int rangeCount;
+        AABB bounds;
+    };
+
+    FrameRing<DrawCommand> commands;
+    std::vector<QuantizedVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Chunk> chunks;
+    GLuint arenaVertexCount = 0;
+    GLuint arenaIndexCount = 0;
+    std::vector<Range> ranges;
+    std::vector<Geometry> geometries;
+    std::vector<DrawCommand> queued;
+    std::vector<unsigned int> queuedBatches;
+    unsigned int batchCount = 1;
+    std::vector<unsigned int> batchStarts;
+    std::vector<DrawCommand> ordered;
+    FrustumCuller culler;
+    std::vector<unsigned char> visible;
+    unsigned int visibleCount = 0;
+    unsigned int culledCount = 0;
+    size_t triangleCount = 0;
+    unsigned int backfacingCount = 0;
+    unsigned int queuedBackfacing = 0;
+    glm::vec3 viewCamera = glm::vec3(0.0f);
+    // 0 until SetView(), always the full level and no cone culling
+    float lodScale = 0.0f;
+    bool coneCulling = false;
+    std::vector<MeshletRecord> meshlets;
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+
+    // compute path
+    bool useCompute;
+    std::unique_ptr<ComputeShader> cullShader;
+    UniformHandle<int> cullJobBase;
+    UniformHandle<int> cullCones;
+    UniformHandle<glm::vec4> cullPlanes;
+    std::unique_ptr<FrameRing<MeshletJob>> jobRing;
+    GLBuffer meshletBuffer;
+    GLBuffer meshletDraws;
+    std::vector<MeshletJob> queuedJobs;
+    std::vector<unsigned int> jobStarts;
+
+    // the coarsest level of range whose error, scaled into the world and projected at the distance of box, stays in
+    // the pixel error. the distance is to the closest point of the box, so a camera inside it gets the full level
+    unsigned int selectLod(const Range& range, const AABB& box, float scale) const
+    {
+        if (lodScale <= 0.0f)
+            return 0;
+        float distance = glm::length(glm::clamp(viewCamera, box.Min, box.Max) - viewCamera);
+        unsigned int level = 0;
+        while (level + 1 < range.lodCount && range.lods[level + 1].Error * scale * lodScale <= distance)
+            level++;
+        return level;
+    }
+
+    // appends source to the meshlets of range, their FirstIndex moved by firstIndex into the index arena
+    void addMeshlets(Range& range, const Meshlet* source, unsigned int count, GLuint firstIndex)
+    {
+        range.firstMeshlet = (unsigned int)meshlets.size();
+        range.meshletCount = count;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const Meshlet& meshlet = source[i];
+            MeshletRecord record = { glm::vec4(meshlet.Sphere.Center, meshlet.Sphere.Radius), glm::vec4(meshlet.ConeAxis, meshlet.ConeCutoff),
+                                     firstIndex + meshlet.FirstIndex, meshlet.IndexCount, range.baseVertex, 0 };
+            meshlets.push_back(record);
+        }
+    }
+
+    // one command per meshlet of range that can face camera (object space), boxed for the frustum test of Submit().
+    // the compute path queues them all as a job instead
+    void queueMeshlets(const Range& range, unsigned int objectIndex, const glm::mat4& model, float scale, const glm::vec3& camera, unsigned int batch)
+    {
+        bool cones = coneCulling && lodScale > 0.0f;
+        if (useCompute && batch < MAX_MESHLET_BATCHES)
+        {
+            MeshletJob job = { model, glm::vec4(camera, scale), range.firstMeshlet, range.meshletCount, objectIndex, batch, 0, {} };
+            queuedJobs.push_back(job);
+            return;
+        }
+        for (unsigned int i = 0; i < range.meshletCount; i++)
+        {
+            const MeshletRecord& meshlet = meshlets[range.firstMeshlet + i];
+            if (cones && meshletBackfacing(glm::vec3(meshlet.sphere), meshlet.sphere.w, glm::vec3(meshlet.cone), meshlet.cone.w, camera))
+            {
+                queuedBackfacing++;
+                continue;
+            }
+            DrawCommand command = { meshlet.indexCount, 1, meshlet.firstIndex, meshlet.baseVertex, objectIndex };
+            queued.push_back(command);
+            queuedBatches.push_back(batch);
+            glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(meshlet.sphere), 1.0f));
+            float radius = meshlet.sphere.w * scale;
+            AABB box;
+            box.Min = center - glm::vec3(radius);
+            box.Max = center + glm::vec3(radius);
+            culler.Add(box);
+        }
+    }
+
+    // compute path: every batch gets a region of the command buffer as large as all meshlets queued under it, one
+    // workgroup per job tests its meshlets and appends the survivors to the region of its batch
+    void cullMeshlets(const Frustum& frustum)
+    {
+        jobStarts.assign(MAX_MESHLET_BATCHES, 0);
+        unsigned int capacity = commands.Capacity(), total = 0;
+        for (unsigned int i = 0; i < queuedJobs.size(); i++)
+        {
+            if (total + queuedJobs[i].meshletCount > capacity)
+            {
+                std::cout << "ERROR::INDIRECT_RENDERER::TOO_MANY_MESHLETS " << total + queuedJobs[i].meshletCount << std::endl;
+                queuedJobs.resize(i);
+                break;
+            }
+            total += queuedJobs[i].meshletCount;
+            jobStarts[queuedJobs[i].batch] += queuedJobs[i].meshletCount;
+        }
+        // region starts, moved on to region ends once the jobs know them, like batchStarts
+        for (unsigned int b = 0, start = 0; b < MAX_MESHLET_BATCHES; b++)
+        {
+            unsigned int size = jobStarts[b];
+            jobStarts[b] = start;
+            start += size;
+        }
+        jobRing->BeginFrame();
+        for (unsigned int i = 0; i < queuedJobs.size(); i++)
+        {
+            queuedJobs[i].outputBase = jobStarts[queuedJobs[i].batch];
+            jobRing->Push(queuedJobs[i]);
+        }
+        for (unsigned int i = 0; i < queuedJobs.size(); i++)
+            jobStarts[queuedJobs[i].batch] += queuedJobs[i].meshletCount;
+
+        // zero the counts on the GPU, queued behind the draws that still read them
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshletDraws.ID());
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(MeshletCullHeader), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        cullShader->use();
+        cullJobBase.Set((int)jobRing->FrameBase());
+        cullCones.Set(coneCulling && lodScale > 0.0f ? 1 : 0);
+        if (cullPlanes.Valid())
+            glUniform4fv(cullPlanes.Location(), 6, &frustum.Planes[0][0]);
+        glDispatchCompute((GLuint)queuedJobs.size(), 1, 1);
+        // the commands and counts are read by the draws below
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        jobRing->EndFrame();
+        queuedJobs.clear();
+    }
+
+    // indices stay local to the mesh, baseVertex moves them to the mesh's place in the vertex arena. lods index meshIndices,
+    // more than MAX_MESH_LODS are dropped
+    Range append(const std::vector<QuantizedVertex>& meshVertices, const std::vector<unsigned int>& meshIndices, const MeshLod* lods, unsigned int lodCount, const AABB& bounds)
+    {
+        Range range = { (GLint)arenaVertexCount, bounds, lodCount < MAX_MESH_LODS ? lodCount : MAX_MESH_LODS, {}, 0, 0 };
+        for (unsigned int l = 0; l < range.lodCount; l++)
+        {
+            range.lods[l] = lods[l];
+            range.lods[l].FirstIndex += arenaIndexCount;
+        }
+        // owned meshes added one after another share a chunk
+        if (chunks.empty() || chunks.back().mappedVertices || chunks.back().firstVertex + chunks.back().vertexCount != arenaVertexCount)
+        {
+            Chunk chunk = { NULL, NULL, vertices.size(), indices.size(), arenaVertexCount, 0, arenaIndexCount, 0 };
+            chunks.push_back(chunk);
+        }
+        chunks.back().vertexCount += (GLuint)meshVertices.size();
+        chunks.back().indexCount += (GLuint)meshIndices.size();
+        arenaVertexCount += (GLuint)meshVertices.size();
+        arenaIndexCount += (GLuint)meshIndices.size();
+        vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+        indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+        return range;
+    }
+};
+#endif
@@ -0,0 +1,167 @@
+#ifndef KTX_TEXTURE_H
+#define KTX_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// A 2D block compressed texture with its full mip chain, stored as a KTX 1.1 file so standard tools can open it.
+// Only what the asset pipeline writes is supported: one face, no array layers, no key/value data, compressed formats.
+struct KtxTexture
+{
+    unsigned int InternalFormat = 0;
+    unsigned int Width = 0;
+    unsigned int Height = 0;
+    // one blob of compressed blocks per mip, level 0 first
+    std::vector<std::vector<unsigned char>> Levels;
+
+    unsigned int MipWidth(unsigned int mip) const { return Width >> mip > 0 ? Width >> mip : 1; }
+    unsigned int MipHeight(unsigned int mip) const { return Height >> mip > 0 ? Height >> mip : 1; }
+
+    // the compressed file the asset pipeline writes for an image: same name, .ktx extension
+    static std::string PathFor(const std::string& imagePath)
+    {
+        size_t dot = imagePath.find_last_of('.');
+        size_t slash = imagePath.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return imagePath + ".ktx";
+        return imagePath.substr(0, dot) + ".ktx";
+    }
+
+    // bytes per 4x4 block of the supported formats, 0 if the format is unknown
+    static unsigned int BlockBytes(unsigned int internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RED_RGTC1: return 8;
+        case GL_COMPRESSED_RG_RGTC2: return 16;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM: return 16;
+        default: return 0;
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        Header header;
+        file.read((char*)&header, sizeof(header));
+        if (!file || std::memcmp(header.identifier, identifier(), 12) != 0 || header.endianness != 0x04030201)
+        {
+            std::cout << "ERROR::KTX::BAD_HEADER " << path << std::endl;
+            return false;
+        }
+        if (BlockBytes(header.glInternalFormat) == 0 || header.pixelDepth > 1 || header.numberOfFaces != 1 ||
+            header.numberOfArrayElements != 0 || header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > 16)
+        {
+            std::cout << "ERROR::KTX::UNSUPPORTED " << path << std::endl;
+            return false;
+        }
+        file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+        InternalFormat = header.glInternalFormat;
+        Width = header.pixelWidth;
+        Height = header.pixelHeight;
+        Levels.resize(header.numberOfMipmapLevels);
+        for (unsigned int mip = 0; mip < Levels.size(); mip++)
+        {
+            uint32_t imageSize = 0;
+            file.read((char*)&imageSize, sizeof(imageSize));
+            if (!file || imageSize != LevelBytes(mip))
+            {
+                std::cout << "ERROR::KTX::DAMAGED_FILE " << path << std::endl;
+                Levels.clear();
+                return false;
+            }
+            Levels[mip].resize(imageSize);
+            file.read((char*)Levels[mip].data(), imageSize);
+        }
+        if (!file)
+        {
+            std::cout << "ERROR::KTX::DAMAGED_FILE " << path << std::endl;
+            Levels.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    bool Save(const std::string& path) const
+    {
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            Header header;
+            std::memcpy(header.identifier, identifier(), 12);
+            header.endianness = 0x04030201;
+            header.glType = 0;
+            header.glTypeSize = 1;
+            header.glFormat = 0;
+            header.glInternalFormat = InternalFormat;
+            header.glBaseInternalFormat = InternalFormat == GL_COMPRESSED_RED_RGTC1 ? GL_RED : InternalFormat == GL_COMPRESSED_RG_RGTC2 ? GL_RG : GL_RGBA;
+            header.pixelWidth = Width;
+            header.pixelHeight = Height;
+            header.pixelDepth = 0;
+            header.numberOfArrayElements = 0;
+            header.numberOfFaces = 1;
+            header.numberOfMipmapLevels = (uint32_t)Levels.size();
+            header.bytesOfKeyValueData = 0;
+            file.write((const char*)&header, sizeof(header));
+            // block sizes are multiples of 4, so no mip padding is ever needed
+            for (unsigned int mip = 0; mip < Levels.size(); mip++)
+            {
+                uint32_t imageSize = (uint32_t)Levels[mip].size();
+                file.write((const char*)&imageSize, sizeof(imageSize));
+                file.write((const char*)Levels[mip].data(), imageSize);
+            }
+            if (!file)
+            {
+                std::cout << "ERROR::KTX::CANNOT_WRITE " << tempPath << std::endl;
+                return false;
+            }
+        }
+        std::remove(path.c_str());
+        std::rename(tempPath.c_str(), path.c_str());
+        return true;
+    }
+
+    size_t LevelBytes(unsigned int mip) const
+    {
+        return (size_t)((MipWidth(mip) + 3) / 4) * ((MipHeight(mip) + 3) / 4) * BlockBytes(InternalFormat);
+    }
+
+private:
+    struct Header
+    {
+        unsigned char identifier[12];
+        uint32_t endianness;
+        uint32_t glType;
+        uint32_t glTypeSize;
+        uint32_t glFormat;
+        uint32_t glInternalFormat;
+        uint32_t glBaseInternalFormat;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t numberOfArrayElements;
+        uint32_t numberOfFaces;
+        uint32_t numberOfMipmapLevels;
+        uint32_t bytesOfKeyValueData;
+    };
+
+    // the KTX 1.1 file identifier
+    static const unsigned char* identifier()
+    {
+        static const unsigned char id[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+        return id;
+    }
+};
+#endif
@@ -0,0 +1,127 @@
+#ifndef LIGHT_BUFFER_H
+#define LIGHT_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_object.h>
+
+#include <algorithm>
+#include <vector>
+
+// one point light of the Light_Data ssbo, mirrors Light_Info in pbr.fs and light_cull.comp.
+// position.w is the radius of influence, the windowed falloff reaches 0 there and the light is culled beyond it
+struct Light_Info
+{
+    glm::vec4 position;
+    glm::vec4 color;
+};
+
+// The Light_Data ssbo: a 16 byte header with the light count, followed by the lights. Lights are added, changed and
+// removed on a CPU copy that marks what it touched. Upload() then writes only the dirty ranges (and the count when it
+// changed), so static lights cost nothing after their first frame. The buffer grows by doubling when it runs out.
+class LightBuffer
+{
+public:
+    // constructor, binds the buffer to binding of GL_SHADER_STORAGE_BUFFER
+    // ------------------------------------------------------------------------
+    LightBuffer(unsigned int binding, unsigned int capacity = 64)
+        : binding(binding), capacity(0), countDirty(true)
+    {
+        reserve(std::max(capacity, 1u));
+    }
+
+    LightBuffer(const LightBuffer&) = delete;
+    LightBuffer& operator=(const LightBuffer&) = delete;
+
+    // returns the index of the new light
+    // ------------------------------------------------------------------------
+    unsigned int Add(const Light_Info& light)
+    {
+        lights.push_back(light);
+        dirty.push_back(true);
+        countDirty = true;
+        return (unsigned int)lights.size() - 1;
+    }
+
+    // ------------------------------------------------------------------------
+    void Set(unsigned int index, const Light_Info& light)
+    {
+        lights[index] = light;
+        dirty[index] = true;
+    }
+
+    // the last light takes the place of the removed one, so only indices equal to Count() - 1 change
+    // ------------------------------------------------------------------------
+    void Remove(unsigned int index)
+    {
+        if (index + 1 != lights.size())
+        {
+            lights[index] = lights.back();
+            dirty[index] = true;
+        }
+        lights.pop_back();
+        dirty.pop_back();
+        countDirty = true;
+    }
+
+    unsigned int Count() const { return (unsigned int)lights.size(); }
+    const Light_Info& Get(unsigned int index) const { return lights[index]; }
+    const Light_Info* Data() const { return lights.data(); }
+
+    // writes the count and every run of dirty lights
+    // ------------------------------------------------------------------------
+    void Upload()
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+        if (lights.size() > capacity)
+        {
+            // a new buffer has nothing in it yet, everything is dirty
+            reserve(std::max((unsigned int)lights.size(), capacity * 2));
+            std::fill(dirty.begin(), dirty.end(), true);
+            countDirty = true;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+        }
+        if (countDirty)
+        {
+            GLuint header[4] = { (GLuint)lights.size(), 0, 0, 0 };
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(header), header);
+            countDirty = false;
+        }
+        unsigned int i = 0;
+        while (i < lights.size())
+        {
+            if (!dirty[i])
+            {
+                i++;
+                continue;
+            }
+            unsigned int begin = i;
+            while (i < lights.size() && dirty[i])
+                dirty[i++] = false;
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, HEADER_SIZE + begin * sizeof(Light_Info), (i - begin) * sizeof(Light_Info), &lights[begin]);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+private:
+    static const unsigned int HEADER_SIZE = 16;
+
+    unsigned int binding;
+    unsigned int capacity;
+    bool countDirty;
+    GLBuffer buffer;
+    std::vector<Light_Info> lights;
+    std::vector<bool> dirty;
+
+    void reserve(unsigned int newCapacity)
+    {
+        buffer = GLBuffer::Create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ID());
+        glBufferData(GL_SHADER_STORAGE_BUFFER, HEADER_SIZE + newCapacity * sizeof(Light_Info), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.ID());
+        capacity = newCapacity;
+    }
+};
+#endif
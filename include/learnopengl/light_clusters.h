@@ -0,0 +1,258 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_ring.h>
+#include <learnopengl/gl_object.h>
+#include <learnopengl/light_buffer.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_c.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+// Clustered forward light assignment. The view frustum is cut into TILES_X * TILES_Y screen tiles and SLICES
+// exponential depth slices. Every cluster gets the list of lights whose sphere of influence touches it, so pbr.fs only
+// shades the lights of its own cluster. The result is two ssbos: Cluster_Data (binding 6) holds an offset and a count
+// per cluster, Light_Index_Data (binding 7) the light indices the offsets point into.
+// Lists are built on the CPU and streamed through FrameRings, or by light_cull.comp straight from the Light_Data ssbo.
+class LightClusters
+{
+public:
+    // keep in sync with CLUSTER_GRID in pbr.fs and light_cull.comp
+    static const unsigned int TILES_X = 16;
+    static const unsigned int TILES_Y = 9;
+    static const unsigned int SLICES = 24;
+    static const unsigned int CLUSTERS = TILES_X * TILES_Y * SLICES;
+    // the compute path writes fixed size lists
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 128;
+
+    // the uniforms of one program that shades with the clusters, see Uniforms()
+    struct ShaderUniforms
+    {
+        UniformHandle<int> base;
+        UniformHandle<glm::vec2> tileSize;
+        UniformHandle<glm::vec4> depth;
+    };
+
+    // constructor, maxIndices bounds the total length of the CPU lists
+    // ------------------------------------------------------------------------
+    LightClusters(bool useCompute, unsigned int maxIndices = CLUSTERS * 32)
+        : useCompute(useCompute), nearPlane(0.1f), farPlane(100.0f), projectionScale(1.0f)
+    {
+        if (useCompute)
+        {
+            cullShader.reset(new ComputeShader("light_cull.comp"));
+            cullDepth = cullShader->Uniform<glm::vec4>("clusterDepth");
+            clusterBuffer = GLBuffer::Create();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterBuffer.ID());
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, CLUSTERS * sizeof(glm::uvec2), NULL, 0);
+            indexBuffer = GLBuffer::Create();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer.ID());
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, CLUSTERS * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint), NULL, 0);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, clusterBuffer.ID());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, indexBuffer.ID());
+        }
+        else
+        {
+            clusterRing.reset(new FrameRing<glm::uvec2>(CLUSTERS, GL_SHADER_STORAGE_BUFFER, 6));
+            indexRing.reset(new FrameRing<GLuint>(maxIndices, GL_SHADER_STORAGE_BUFFER, 7));
+            counts.resize(CLUSTERS);
+            offsets.resize(CLUSTERS);
+        }
+    }
+
+    // the perspective the clusters are cut from, call again when it changes
+    // ------------------------------------------------------------------------
+    void SetProjection(const glm::mat4& projection, float nearPlane, float farPlane)
+    {
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+        projectionScale = glm::vec2(projection[0][0], projection[1][1]);
+    }
+
+    // builds the light lists of this frame from the lights in world space. the compute path reads them from the
+    // Light_Data ssbo and the camera from the FrameData block, so upload and bind both first
+    // ------------------------------------------------------------------------
+    void Update(const LightBuffer& lights, const glm::mat4& view)
+    {
+        if (useCompute)
+            cull();
+        else
+            assign(lights.Data(), lights.Count(), view);
+    }
+
+    // fences this frame's CPU lists, call once every draw reading them is queued
+    // ------------------------------------------------------------------------
+    void EndFrame()
+    {
+        if (!useCompute)
+        {
+            clusterRing->EndFrame();
+            indexRing->EndFrame();
+        }
+    }
+
+    // looks up the uniforms pbr.fs needs to find its cluster, once per program
+    // ------------------------------------------------------------------------
+    static ShaderUniforms Uniforms(const Shader& shader)
+    {
+        ShaderUniforms uniforms;
+        uniforms.base = shader.Uniform<int>("clusterBase");
+        uniforms.tileSize = shader.Uniform<glm::vec2>("clusterTileSize");
+        uniforms.depth = shader.Uniform<glm::vec4>("clusterDepth");
+        return uniforms;
+    }
+
+    // sets them on the program in use, width and height are the framebuffer size
+    // ------------------------------------------------------------------------
+    void SetUniforms(const ShaderUniforms& uniforms, int width, int height) const
+    {
+        uniforms.base.Set(useCompute ? 0 : (int)clusterRing->FrameBase());
+        uniforms.tileSize.Set(glm::vec2((float)width / TILES_X, (float)height / TILES_Y));
+        uniforms.depth.Set(depthParams());
+    }
+
+private:
+    bool useCompute;
+    float nearPlane;
+    float farPlane;
+    glm::vec2 projectionScale;
+
+    std::unique_ptr<ComputeShader> cullShader;
+    UniformHandle<glm::vec4> cullDepth;
+    GLBuffer clusterBuffer;
+    GLBuffer indexBuffer;
+
+    std::unique_ptr<FrameRing<glm::uvec2>> clusterRing;
+    std::unique_ptr<FrameRing<GLuint>> indexRing;
+    std::vector<unsigned int> counts;
+    std::vector<unsigned int> offsets;
+    // cluster range of every light, found in the counting pass and reused by the fill pass
+    std::vector<glm::uvec4> tileRanges;
+    std::vector<glm::uvec2> sliceRanges;
+    std::vector<GLuint> indices;
+
+    // near, far, and the scale and bias that map log(depth) to a slice
+    glm::vec4 depthParams() const
+    {
+        float logRatio = std::log(farPlane / nearPlane);
+        return glm::vec4(nearPlane, farPlane, SLICES / logRatio, SLICES * std::log(nearPlane) / logRatio);
+    }
+
+    unsigned int sliceOf(float depth) const
+    {
+        glm::vec4 params = depthParams();
+        float slice = std::log(depth) * params.z - params.w;
+        return (unsigned int)glm::clamp(slice, 0.0f, (float)(SLICES - 1));
+    }
+
+    static unsigned int tileOf(float ndc, unsigned int tiles)
+    {
+        return (unsigned int)glm::clamp((ndc * 0.5f + 0.5f) * tiles, 0.0f, (float)(tiles - 1));
+    }
+
+    // conservative cluster range of a view space sphere, false when it is outside the depth range
+    bool clusterRange(const glm::vec3& center, float radius, glm::uvec4& tiles, glm::uvec2& slices) const
+    {
+        float depth = -center.z;
+        float nearDepth = std::max(depth - radius, nearPlane);
+        float farDepth = std::min(depth + radius, farPlane);
+        if (nearDepth > farDepth)
+            return false;
+        slices = glm::uvec2(sliceOf(nearDepth), sliceOf(farDepth));
+
+        // the widest projection of each side of the bounding box, over the depth range it spans
+        glm::vec2 low = glm::vec2(center) - radius;
+        glm::vec2 high = glm::vec2(center) + radius;
+        glm::vec2 ndcLow, ndcHigh;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            ndcLow[axis] = projectionScale[axis] * low[axis] / (low[axis] < 0.0f ? nearDepth : farDepth);
+            ndcHigh[axis] = projectionScale[axis] * high[axis] / (high[axis] > 0.0f ? nearDepth : farDepth);
+        }
+        if (ndcLow.x > 1.0f || ndcLow.y > 1.0f || ndcHigh.x < -1.0f || ndcHigh.y < -1.0f)
+            return false;
+        tiles = glm::uvec4(tileOf(ndcLow.x, TILES_X), tileOf(ndcLow.y, TILES_Y), tileOf(ndcHigh.x, TILES_X), tileOf(ndcHigh.y, TILES_Y));
+        return true;
+    }
+
+    // CPU path: count the lights per cluster, prefix sum into offsets, then fill the index list
+    void assign(const Light_Info* lights, unsigned int lightCount, const glm::mat4& view)
+    {
+        std::fill(counts.begin(), counts.end(), 0u);
+        tileRanges.resize(lightCount);
+        sliceRanges.resize(lightCount);
+        for (unsigned int i = 0; i < lightCount; i++)
+        {
+            glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].position), 1.0f));
+            if (!clusterRange(center, lights[i].position.w, tileRanges[i], sliceRanges[i]))
+            {
+                sliceRanges[i] = glm::uvec2(1, 0);
+                continue;
+            }
+            forEachCluster(tileRanges[i], sliceRanges[i], [this](unsigned int cluster) { counts[cluster]++; });
+        }
+
+        clusterRing->BeginFrame();
+        indexRing->BeginFrame();
+        unsigned int base = indexRing->FrameBase();
+        unsigned int total = 0;
+        bool full = false;
+        for (unsigned int cluster = 0; cluster < CLUSTERS; cluster++)
+        {
+            unsigned int count = std::min(counts[cluster], indexRing->Capacity() - total);
+            full = full || count < counts[cluster];
+            offsets[cluster] = total;
+            clusterRing->Push(glm::uvec2(base + total, count));
+            counts[cluster] = count;
+            total += count;
+        }
+        if (full)
+            std::cout << "ERROR::LIGHT_CLUSTERS::INDEX_LIST_FULL " << indexRing->Capacity() << std::endl;
+
+        // counts is now the room left in each list, offsets the next free slot. the ring hands out slots in order,
+        // so the list is put together here and pushed in one go
+        indices.resize(total);
+        for (unsigned int i = 0; i < lightCount; i++)
+        {
+            if (sliceRanges[i].x > sliceRanges[i].y)
+                continue;
+            forEachCluster(tileRanges[i], sliceRanges[i], [this, i](unsigned int cluster)
+            {
+                if (counts[cluster] > 0)
+                {
+                    indices[offsets[cluster]++] = i;
+                    counts[cluster]--;
+                }
+            });
+        }
+        for (unsigned int i = 0; i < total; i++)
+            indexRing->Push(indices[i]);
+    }
+
+    template <typename F>
+    static void forEachCluster(const glm::uvec4& tiles, const glm::uvec2& slices, F visit)
+    {
+        for (unsigned int slice = slices.x; slice <= slices.y; slice++)
+            for (unsigned int y = tiles.y; y <= tiles.w; y++)
+                for (unsigned int x = tiles.x; x <= tiles.z; x++)
+                    visit((slice * TILES_Y + y) * TILES_X + x);
+    }
+
+    // compute path: one invocation per cluster tests every light against the cluster's view space bounds
+    void cull()
+    {
+        cullShader->use();
+        cullDepth.Set(depthParams());
+        glDispatchCompute((CLUSTERS + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+};
+#endif
@@ -6,12 +6,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/bounds.h>
+#include <learnopengl/gl_object.h>
+#include <learnopengl/meshlets.h>
+#include <learnopengl/packed_vertex.h>
 #include <learnopengl/shader.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -28,6 +33,17 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// one level of detail, a range of the index buffer of its mesh. every level indexes the same vertices
+struct MeshLod {
+    unsigned int FirstIndex;
+    unsigned int IndexCount;
+    // largest distance, in object space, the level moves the surface away from the full mesh
+    float Error;
+};
+
+// the full mesh and up to four simplified levels
+const unsigned int MAX_MESH_LODS = 5;
+
 struct Texture {
     unsigned int id;
     string type;
@@ -40,22 +56,35 @@ public:
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
-    unsigned int VAO;
+    GLVertexArray VAO;
+    // object space bounds, filled in by the loader
+    AABB Bounds;
+    BoundingSphere Sphere;
+    // index into the material names of the model
+    unsigned int Material = 0;
+    // ranges of indices, the full mesh first and coarser levels after it
+    vector<MeshLod> Lods;
+    // the full level cut into meshlets, filled in by the loader. empty when it was not
+    vector<Meshlet> Meshlets;
 
     /*  Functions  */
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes the data over. a mesh owns its GL objects, so it can be moved but not copied. without lods all
+    // indices are the one full level
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>())
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->Lods = std::move(lods);
+        if(Lods.empty())
+            Lods.push_back(MeshLod{ 0, (unsigned int)this->indices.size(), 0.0f });
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
     // render the mesh
-    void Draw(Shader shader) 
+    void Draw(const Shader& shader) 
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -84,54 +113,65 @@ public:
         }
         
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(VAO.ID());
+        glDrawElements(GL_TRIANGLES, Lods[0].IndexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render the mesh without touching textures or uniforms, the shader finds its per-object data through gl_BaseInstance.
+    // positions are not quantized, the record takes a default PositionQuantization
+    void Draw(unsigned int baseInstance)
+    {
+        glBindVertexArray(VAO.ID());
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, Lods[0].IndexCount, GL_UNSIGNED_INT, 0, 1, baseInstance);
+        glBindVertexArray(0);
+    }
+
 private:
     /*  Render data  */
-    unsigned int VBO, EBO;
+    GLBuffer VBO, EBO;
 
     /*  Functions    */
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
         // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        VAO = GLVertexArray::Create();
+        VBO = GLBuffer::Create();
+        EBO = GLBuffer::Create();
 
-        glBindVertexArray(VAO);
+        // the GPU copy is the packed layout pbr.vs reads, the full vertices stay on the CPU for the caches and arenas
+        vector<PackedVertex> packed(vertices.size());
+        for(unsigned int i = 0; i < vertices.size(); i++)
+        {
+            const Vertex& vertex = vertices[i];
+            packed[i] = PackedVertex::Pack(vertex.Position, vertex.Normal, tangentFrame(vertex.Normal, vertex.Tangent, vertex.Bitangent), vertex.TexCoords);
+        }
+
+        glBindVertexArray(VAO.ID());
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.ID());
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.ID());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
         // vertex texture coords
+        glEnableVertexAttribArray(1);	
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        // vertex normals
         glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex tangent
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        // vertex tangent and bitangent sign
         glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
 
         glBindVertexArray(0);
     }
@@ -0,0 +1,326 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/meshlets.h>
+#include <learnopengl/packed_vertex.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// The meshes of one model file in the exact layout the renderer uploads, written once from the Assimp import and memory
+// mapped on every later run. The file is a header, one record per mesh (its ranges, bounds and material), the material
+// names, the meshlets, then the vertex and index streams of all meshes back to back. The index stream of a mesh holds all
+// its levels of detail. Sections start on 16 byte boundaries, so the
+// streams can go from the mapping into a buffer as they are. The vertices are QuantizedVertex, with positions quantized
+// against the bounds in the header (the bounds of all meshes). The key hashes the size and modification time of the
+// source file, a changed model just misses the cache and is imported again.
+class MeshCache
+{
+public:
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
+        uint32_t VertexStride;
+        uint32_t MeshCount;
+        uint32_t MaterialCount;
+        uint32_t VertexCount;
+        uint32_t IndexCount;
+        // byte offsets of the sections from the start of the file
+        uint32_t MeshOffset;
+        uint32_t MaterialOffset;
+        uint32_t VertexOffset;
+        uint32_t IndexOffset;
+        uint32_t MeshletCount;
+        uint32_t MeshletOffset;
+        uint32_t Padding;
+        // all meshes, object space. the positions are quantized against it
+        AABB Bounds;
+    };
+
+    // a MeshLod, FirstIndex counts from the first index of its mesh
+    struct LodRecord
+    {
+        uint32_t FirstIndex;
+        uint32_t IndexCount;
+        float Error;
+        uint32_t Padding;
+    };
+
+    // indices are local to the mesh, FirstVertex is the base vertex to draw them with. IndexCount covers all levels
+    struct MeshRecord
+    {
+        uint32_t FirstIndex;
+        uint32_t IndexCount;
+        uint32_t FirstVertex;
+        uint32_t VertexCount;
+        // index into the material names
+        uint32_t Material;
+        // used entries of Lods, the full mesh first
+        uint32_t LodCount;
+        AABB Bounds;
+        BoundingSphere Sphere;
+        LodRecord Lods[MAX_MESH_LODS];
+        // meshlets of the full level, their FirstIndex counts from the first index of the mesh
+        uint32_t FirstMeshlet;
+        uint32_t MeshletCount;
+    };
+
+    static const unsigned int MATERIAL_NAME_LENGTH = 64;
+
+    uint64_t Key;
+    std::string CachePath;
+
+    // constructor, keys the cache of sourcePath (<sourcePath>.meshcache) by the state of the source file
+    // ------------------------------------------------------------------------
+    MeshCache(const std::string& sourcePath)
+        : Key(FNV_OFFSET), CachePath(sourcePath + ".meshcache"), header(nullptr)
+    {
+        struct stat info;
+        uint64_t source[2] = { 0, 0 };
+        if (stat(sourcePath.c_str(), &info) == 0)
+        {
+            source[0] = (uint64_t)info.st_size;
+            source[1] = (uint64_t)info.st_mtime;
+        }
+        Key = hashBytes(source, sizeof(source), Key);
+        uint32_t version = VERSION;
+        Key = hashBytes(&version, sizeof(version), Key);
+    }
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    // maps the cache file. returns false on a miss or a damaged file. besides the header and the records only the index
+    // stream is read, every index is checked against the vertices of its mesh so a damaged file cannot draw out of bounds
+    // ------------------------------------------------------------------------
+    bool Load()
+    {
+        Close();
+        if (!file.Open(CachePath))
+            return false;
+
+        const Header* candidate = (const Header*)file.Data();
+        if (file.Size() < sizeof(Header) || candidate->Magic != MAGIC || candidate->Version != VERSION ||
+            candidate->Key != Key || candidate->VertexStride != sizeof(QuantizedVertex))
+        {
+            file.Close();
+            return false;
+        }
+        if (!fits(candidate->MeshOffset, candidate->MeshCount, sizeof(MeshRecord)) ||
+            !fits(candidate->MaterialOffset, candidate->MaterialCount, MATERIAL_NAME_LENGTH) ||
+            !fits(candidate->MeshletOffset, candidate->MeshletCount, sizeof(Meshlet)) ||
+            !fits(candidate->VertexOffset, candidate->VertexCount, sizeof(QuantizedVertex)) ||
+            !fits(candidate->IndexOffset, candidate->IndexCount, sizeof(uint32_t)))
+        {
+            std::cout << "ERROR::MESH_CACHE::DAMAGED_FILE " << CachePath << std::endl;
+            file.Close();
+            return false;
+        }
+        const MeshRecord* records = (const MeshRecord*)(file.Data() + candidate->MeshOffset);
+        const Meshlet* meshlets = (const Meshlet*)(file.Data() + candidate->MeshletOffset);
+        const uint32_t* indices = (const uint32_t*)(file.Data() + candidate->IndexOffset);
+        for (unsigned int i = 0; i < candidate->MeshCount; i++)
+        {
+            const MeshRecord& record = records[i];
+            bool valid = (uint64_t)record.FirstIndex + record.IndexCount <= candidate->IndexCount &&
+                         (uint64_t)record.FirstVertex + record.VertexCount <= candidate->VertexCount &&
+                         (candidate->MaterialCount == 0 || record.Material < candidate->MaterialCount) &&
+                         record.LodCount > 0 && record.LodCount <= MAX_MESH_LODS &&
+                         (uint64_t)record.FirstMeshlet + record.MeshletCount <= candidate->MeshletCount;
+            for (unsigned int l = 0; valid && l < record.LodCount; l++)
+                valid = (uint64_t)record.Lods[l].FirstIndex + record.Lods[l].IndexCount <= record.IndexCount;
+            for (unsigned int m = 0; valid && m < record.MeshletCount; m++)
+                valid = (uint64_t)meshlets[record.FirstMeshlet + m].FirstIndex + meshlets[record.FirstMeshlet + m].IndexCount <= record.IndexCount;
+            // indices are local to the mesh
+            for (unsigned int n = 0; valid && n < record.IndexCount; n++)
+                valid = indices[record.FirstIndex + n] < record.VertexCount;
+            if (!valid)
+            {
+                std::cout << "ERROR::MESH_CACHE::DAMAGED_FILE " << CachePath << std::endl;
+                file.Close();
+                return false;
+            }
+        }
+        header = candidate;
+        return true;
+    }
+
+    // unmaps the file, everything returned by the accessors below becomes invalid
+    // ------------------------------------------------------------------------
+    void Close()
+    {
+        header = nullptr;
+        file.Close();
+    }
+
+    bool IsLoaded() const { return header != nullptr; }
+
+    // only valid while loaded
+    const Header& Info() const { return *header; }
+    const MeshRecord* Meshes() const { return (const MeshRecord*)(file.Data() + header->MeshOffset); }
+    const Meshlet* Meshlets() const { return (const Meshlet*)(file.Data() + header->MeshletOffset); }
+    const QuantizedVertex* Vertices() const { return (const QuantizedVertex*)(file.Data() + header->VertexOffset); }
+    const uint32_t* Indices() const { return (const uint32_t*)(file.Data() + header->IndexOffset); }
+
+    // name of material index, empty when the model had no materials
+    // ------------------------------------------------------------------------
+    std::string MaterialName(unsigned int material) const
+    {
+        if (material >= header->MaterialCount)
+            return std::string();
+        const char* name = (const char*)(file.Data() + header->MaterialOffset) + material * MATERIAL_NAME_LENGTH;
+        const char* end = (const char*)std::memchr(name, 0, MATERIAL_NAME_LENGTH);
+        return std::string(name, end ? end : name + MATERIAL_NAME_LENGTH);
+    }
+
+    // writes meshes (as loaded by Model) and the material names their Material indices refer to. names longer than
+    // MATERIAL_NAME_LENGTH - 1 are cut. a temp file is renamed over the old cache at the end, like IBLCache does
+    // ------------------------------------------------------------------------
+    bool Save(const std::vector<Mesh>& meshes, const std::vector<std::string>& materials)
+    {
+        Header out = {};
+        out.Magic = MAGIC;
+        out.Version = VERSION;
+        out.Key = Key;
+        out.VertexStride = sizeof(QuantizedVertex);
+        out.MeshCount = (uint32_t)meshes.size();
+        out.MaterialCount = (uint32_t)materials.size();
+
+        std::vector<MeshRecord> records(meshes.size(), MeshRecord());
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            MeshRecord& record = records[i];
+            record.FirstIndex = out.IndexCount;
+            record.IndexCount = (uint32_t)meshes[i].indices.size();
+            record.FirstVertex = out.VertexCount;
+            record.VertexCount = (uint32_t)meshes[i].vertices.size();
+            record.Material = meshes[i].Material;
+            record.Bounds = meshes[i].Bounds;
+            record.Sphere = meshes[i].Sphere;
+            const std::vector<MeshLod>& lods = meshes[i].Lods;
+            record.LodCount = (uint32_t)(lods.size() < MAX_MESH_LODS ? lods.size() : MAX_MESH_LODS);
+            for (unsigned int l = 0; l < record.LodCount; l++)
+            {
+                record.Lods[l].FirstIndex = lods[l].FirstIndex;
+                record.Lods[l].IndexCount = lods[l].IndexCount;
+                record.Lods[l].Error = lods[l].Error;
+            }
+            record.FirstMeshlet = out.MeshletCount;
+            record.MeshletCount = (uint32_t)meshes[i].Meshlets.size();
+            out.MeshletCount += record.MeshletCount;
+            out.IndexCount += record.IndexCount;
+            out.VertexCount += record.VertexCount;
+            out.Bounds.Extend(record.Bounds);
+        }
+        out.MeshOffset = align(sizeof(Header));
+        out.MaterialOffset = align(out.MeshOffset + records.size() * sizeof(MeshRecord));
+        out.MeshletOffset = align(out.MaterialOffset + materials.size() * MATERIAL_NAME_LENGTH);
+        out.VertexOffset = align(out.MeshletOffset + (size_t)out.MeshletCount * sizeof(Meshlet));
+        out.IndexOffset = align(out.VertexOffset + (size_t)out.VertexCount * sizeof(QuantizedVertex));
+
+        std::string tempPath = CachePath + ".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            stream.write((const char*)&out, sizeof(out));
+            pad(stream, out.MeshOffset);
+            if (!records.empty())
+                stream.write((const char*)records.data(), records.size() * sizeof(MeshRecord));
+            pad(stream, out.MaterialOffset);
+            for (unsigned int i = 0; i < materials.size(); i++)
+            {
+                char name[MATERIAL_NAME_LENGTH] = {};
+                std::strncpy(name, materials[i].c_str(), MATERIAL_NAME_LENGTH - 1);
+                stream.write(name, MATERIAL_NAME_LENGTH);
+            }
+            pad(stream, out.MeshletOffset);
+            for (unsigned int i = 0; i < meshes.size(); i++)
+                if (!meshes[i].Meshlets.empty())
+                    stream.write((const char*)meshes[i].Meshlets.data(), meshes[i].Meshlets.size() * sizeof(Meshlet));
+            pad(stream, out.VertexOffset);
+            // the packing happens here, once, instead of on every load
+            PositionQuantization quantization(out.Bounds);
+            std::vector<QuantizedVertex> vertices;
+            for (unsigned int i = 0; i < meshes.size(); i++)
+            {
+                const std::vector<Vertex>& source = meshes[i].vertices;
+                vertices.resize(source.size());
+                for (unsigned int v = 0; v < source.size(); v++)
+                    vertices[v] = QuantizedVertex::Pack(quantization, source[v].Position, source[v].Normal, tangentFrame(source[v].Normal, source[v].Tangent, source[v].Bitangent), source[v].TexCoords);
+                if (!vertices.empty())
+                    stream.write((const char*)vertices.data(), vertices.size() * sizeof(QuantizedVertex));
+            }
+            pad(stream, out.IndexOffset);
+            for (unsigned int i = 0; i < meshes.size(); i++)
+                if (!meshes[i].indices.empty())
+                    stream.write((const char*)meshes[i].indices.data(), meshes[i].indices.size() * sizeof(uint32_t));
+            if (!stream)
+            {
+                std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << tempPath << std::endl;
+                return false;
+            }
+        }
+        // the old file may still be mapped by this object
+        Close();
+        std::remove(CachePath.c_str());
+        return std::rename(tempPath.c_str(), CachePath.c_str()) == 0;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x48534D50; // "PMSH"
+    static const uint32_t VERSION = 6;
+    static const uint32_t SECTION_ALIGNMENT = 16;
+    static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    MappedFile file;
+    const Header* header;
+
+    static uint32_t align(size_t offset)
+    {
+        return (uint32_t)((offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT);
+    }
+
+    // true when count elements of size bytes at offset lie inside the mapping and the section is aligned
+    bool fits(uint32_t offset, uint32_t count, size_t size) const
+    {
+        return offset % SECTION_ALIGNMENT == 0 && (uint64_t)offset + (uint64_t)count * size <= file.Size();
+    }
+
+    static void pad(std::ofstream& stream, uint32_t offset)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        std::streamoff position = stream.tellp();
+        if (position >= 0 && position < (std::streamoff)offset)
+            stream.write(zeros, offset - position);
+    }
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+};
+
+static_assert(sizeof(MeshCache::Header) == 88, "MeshCache::Header is read straight from the mapping, keep its size");
+static_assert(sizeof(MeshCache::MeshRecord) == 152, "MeshCache::MeshRecord is read straight from the mapping, keep its size");
+#endif
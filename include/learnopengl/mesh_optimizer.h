@@ -0,0 +1,331 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// post-transform cache efficiency of an index buffer
+struct VertexCacheStats
+{
+    // average cache miss ratio, vertex shader runs per triangle: 3 for no reuse, about 0.5 at best for regular grids
+    float acmr = 0.0f;
+    // average transform to vertex ratio, vertex shader runs per referenced vertex: 1 is perfect
+    float atvr = 0.0f;
+};
+
+// Import time reordering of triangle lists, run in this order by the model loader:
+//   OptimizeVertexCache  Forsyth's "Linear-Speed Vertex Cache Optimisation", greedy triangle order by an LRU score
+//   OptimizeOverdraw     cuts the order into clusters where the cache is cheap to break and draws outward facing
+//                        clusters first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+//   OptimizeVertexFetch  renumbers vertices in the order the indices first use them, so fetches walk memory forward
+// AnalyzeVertexCache is the benchmark: a FIFO post-transform cache simulated on the CPU, deterministic for a given order.
+class MeshOptimizer
+{
+public:
+    // size of the simulated FIFO, the fixed cache of most hardware that has one
+    static const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+    // simulates indices through a FIFO cache of cacheSize vertices
+    // ------------------------------------------------------------------------
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        if (indices.size() < 3)
+            return stats;
+
+        // a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+        std::vector<unsigned int> loadedAt(vertexCount, 0);
+        std::vector<unsigned char> referenced(vertexCount, 0);
+        unsigned int time = cacheSize + 1;
+        size_t misses = 0, unique = 0;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int v = indices[i];
+            if (time - loadedAt[v] > cacheSize)
+            {
+                loadedAt[v] = time++;
+                misses++;
+            }
+            if (!referenced[v])
+            {
+                referenced[v] = 1;
+                unique++;
+            }
+        }
+        stats.acmr = (float)misses / (float)(indices.size() / 3);
+        stats.atvr = (float)misses / (float)unique;
+        return stats;
+    }
+
+    // reorders the triangles of indices for the post-transform cache
+    // ------------------------------------------------------------------------
+    static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles around every vertex, the live ones (not emitted yet) first
+        std::vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            offsets[indices[i] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        std::vector<unsigned int> live(vertexCount, 0);
+        std::vector<unsigned int> adjacency(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                adjacency[offsets[v] + live[v]++] = (unsigned int)t;
+            }
+
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScores[v] = vertexScore(-1, live[v]);
+        std::vector<float> triangleScores(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+        std::vector<unsigned char> emitted(triangleCount, 0);
+        std::vector<unsigned int> ordered;
+        ordered.reserve(triangleCount * 3);
+        unsigned int cache[SCORE_CACHE_SIZE + 3];
+        unsigned int newCache[SCORE_CACHE_SIZE + 3];
+        unsigned int cacheCount = 0;
+        size_t scan = 0;
+
+        int current = (int)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+        while (current >= 0)
+        {
+            const unsigned int* triangle = &indices[current * 3];
+            ordered.insert(ordered.end(), triangle, triangle + 3);
+            emitted[current] = 1;
+
+            // the triangle is no longer live around its vertices
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = triangle[k];
+                unsigned int* begin = &adjacency[offsets[v]];
+                unsigned int* end = begin + live[v];
+                unsigned int* found = std::find(begin, end, (unsigned int)current);
+                if (found != end)
+                {
+                    std::swap(*found, *(end - 1));
+                    live[v]--;
+                }
+            }
+
+            // the triangle's vertices move to the front of the LRU cache, the rest shifts back
+            unsigned int newCount = 0;
+            for (int k = 0; k < 3; k++)
+                if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+                    newCache[newCount++] = triangle[k];
+            for (unsigned int i = 0; i < cacheCount; i++)
+                if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+                    newCache[newCount++] = cache[i];
+
+            // rescore every vertex whose cache position changed, the ones that fell out included
+            current = -1;
+            float best = -1.0f;
+            for (unsigned int i = 0; i < newCount; i++)
+            {
+                unsigned int v = newCache[i];
+                float score = vertexScore(i < SCORE_CACHE_SIZE ? (int)i : -1, live[v]);
+                float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+                for (unsigned int a = 0; a < live[v]; a++)
+                {
+                    unsigned int t = adjacency[offsets[v] + a];
+                    triangleScores[t] += delta;
+                }
+            }
+            cacheCount = newCount < SCORE_CACHE_SIZE ? newCount : SCORE_CACHE_SIZE;
+            std::copy(newCache, newCache + cacheCount, cache);
+
+            // the next triangle is the best one touching the cache
+            for (unsigned int i = 0; i < cacheCount; i++)
+            {
+                unsigned int v = cache[i];
+                for (unsigned int a = 0; a < live[v]; a++)
+                {
+                    unsigned int t = adjacency[offsets[v] + a];
+                    if (triangleScores[t] > best)
+                    {
+                        best = triangleScores[t];
+                        current = (int)t;
+                    }
+                }
+            }
+            // dead end, continue with the next triangle not emitted yet
+            if (current < 0)
+            {
+                while (scan < triangleCount && emitted[scan])
+                    scan++;
+                if (scan < triangleCount)
+                    current = (int)scan;
+            }
+        }
+        indices.swap(ordered);
+    }
+
+    // reorders clusters of triangles so the ones facing away from the center are drawn first. threshold is how much
+    // worse than the incoming order the ACMR may get, 1.05 allows 5%. run it after OptimizeVertexCache
+    // ------------------------------------------------------------------------
+    static void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        // hard boundaries, where a triangle misses all of its vertices the cache starts over anyway
+        std::vector<unsigned int> loadedAt(positions.size(), 0);
+        unsigned int time = cacheSize + 1;
+        std::vector<size_t> hard;
+        for (size_t t = 0; t < triangleCount; t++)
+            if (triangleMisses(indices, t, loadedAt, time, cacheSize) == 3 || t == 0)
+                hard.push_back(t);
+        hard.push_back(triangleCount);
+
+        // soft boundaries, a hard cluster is cut again as soon as its prefix is within threshold of its own ACMR
+        std::vector<size_t> clusters;
+        for (size_t h = 0; h + 1 < hard.size(); h++)
+        {
+            size_t start = hard[h], end = hard[h + 1];
+            time += cacheSize + 1;
+            size_t clusterMisses = 0;
+            for (size_t t = start; t < end; t++)
+                clusterMisses += triangleMisses(indices, t, loadedAt, time, cacheSize);
+            float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+            time += cacheSize + 1;
+            size_t first = start, misses = 0;
+            clusters.push_back(start);
+            for (size_t t = start; t < end; t++)
+            {
+                misses += triangleMisses(indices, t, loadedAt, time, cacheSize);
+                if (t + 1 < end && (float)misses <= (float)(t + 1 - first) * clusterThreshold)
+                {
+                    clusters.push_back(t + 1);
+                    first = t + 1;
+                    misses = 0;
+                    time += cacheSize + 1;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // area weighted center of the mesh, then center and normal of every cluster
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        size_t clusterCount = clusters.size() - 1;
+        std::vector<glm::vec3> centers(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            float area = 0.0f;
+            for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const glm::vec3& a = positions[indices[t * 3]];
+                const glm::vec3& b = positions[indices[t * 3 + 1]];
+                const glm::vec3& d = positions[indices[t * 3 + 2]];
+                glm::vec3 normal = glm::cross(b - a, d - a);
+                float triangleArea = glm::length(normal);
+                centers[c] += (a + b + d) * (triangleArea / 3.0f);
+                normals[c] += normal;
+                area += triangleArea;
+            }
+            meshCenter += centers[c];
+            meshArea += area;
+            centers[c] = area > 0.0f ? centers[c] / area : positions[indices[clusters[c] * 3]];
+            float length = glm::length(normals[c]);
+            normals[c] = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+        }
+        if (meshArea > 0.0f)
+            meshCenter /= meshArea;
+
+        std::vector<float> keys(clusterCount);
+        std::vector<size_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            keys[c] = glm::dot(centers[c] - meshCenter, normals[c]);
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+        std::vector<unsigned int> sorted;
+        sorted.reserve(indices.size());
+        for (size_t i = 0; i < clusterCount; i++)
+        {
+            size_t c = order[i];
+            sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        }
+        indices.swap(sorted);
+    }
+
+    // renumbers vertices in first use order and drops the ones no index refers to
+    // ------------------------------------------------------------------------
+    template <typename Vertex>
+    static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unused);
+        std::vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int& target = remap[indices[i]];
+            if (target == unused)
+            {
+                target = (unsigned int)ordered.size();
+                ordered.push_back(vertices[indices[i]]);
+            }
+            indices[i] = target;
+        }
+        vertices.swap(ordered);
+    }
+
+private:
+    // Forsyth's scoring constants
+    static const unsigned int SCORE_CACHE_SIZE = 32;
+
+    static float vertexScore(int cachePosition, unsigned int liveTriangles)
+    {
+        if (liveTriangles == 0)
+            return 0.0f;
+        const float cacheDecayPower = 1.5f;
+        const float lastTriangleScore = 0.75f;
+        const float valenceBoostScale = 2.0f;
+        const float valenceBoostPower = 0.5f;
+
+        float score = 0.0f;
+        // the vertices of the last triangle get a fixed score, so the order does not depend on which one came first
+        if (cachePosition >= 0 && cachePosition < 3)
+            score = lastTriangleScore;
+        else if (cachePosition >= 3)
+            score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(SCORE_CACHE_SIZE - 3), cacheDecayPower);
+        // vertices with few triangles left are finished first, so they do not turn into stragglers
+        score += valenceBoostScale * std::pow((float)liveTriangles, -valenceBoostPower);
+        return score;
+    }
+
+    // misses of one triangle in the FIFO simulation of AnalyzeVertexCache
+    static unsigned int triangleMisses(const std::vector<unsigned int>& indices, size_t triangle, std::vector<unsigned int>& loadedAt, unsigned int& time, unsigned int cacheSize)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[triangle * 3 + k];
+            if (time - loadedAt[v] > cacheSize)
+            {
+                loadedAt[v] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+};
+#endif
@@ -0,0 +1,524 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+// Quadric error metric simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+// restricted to collapsing a vertex onto one of its neighbours, so every level indexes the vertex buffer of the
+// full mesh and the levels can share one index buffer. Vertices on open borders only slide along the border, and
+// vertices on attribute seams (one position, two vertices) only along the seam, taking their twin with them, so
+// silhouettes and uv charts stay closed. Planes through those edges add to the cost to keep the sliding on the line.
+// Corners where borders or seams meet never move. The normal and uv a collapse drags across the surface add to its cost
+// next to the geometric error, so creases and uv detail go last.
+class MeshSimplifier
+{
+public:
+    // levels below this many triangles are not worth their draw
+    static const unsigned int MIN_LOD_TRIANGLES = 64;
+
+    // indices reduced towards targetIndexCount. error receives the largest distance, in the units of positions, any
+    // collapse moved the surface by. stops early when only locked vertices or flipping collapses are left
+    // ------------------------------------------------------------------------
+    static std::vector<unsigned int> Simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+                                              const std::vector<glm::vec2>& texCoords, size_t targetIndexCount, float& error)
+    {
+        std::vector<std::vector<unsigned int> > levels;
+        std::vector<float> errors;
+        simplify(indices, positions, normals, texCoords, std::vector<size_t>(1, targetIndexCount), levels, errors);
+        error = errors[0];
+        return levels[0];
+    }
+
+    // appends up to maxLods - 1 coarser levels of the first (full) level to indices, each about half of the one before
+    // and ordered for the vertex cache. lods receives every level, the full one first, with its error
+    // ------------------------------------------------------------------------
+    static void BuildLods(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+                          const std::vector<glm::vec2>& texCoords, std::vector<MeshLod>& lods, unsigned int maxLods = MAX_MESH_LODS)
+    {
+        lods.clear();
+        MeshLod full = { 0, (unsigned int)indices.size(), 0.0f };
+        lods.push_back(full);
+        std::vector<size_t> targets;
+        for (size_t target = indices.size() / 6 * 3; targets.size() + 1 < maxLods && target >= MIN_LOD_TRIANGLES * 3; target = target / 6 * 3)
+            targets.push_back(target);
+        if (targets.empty())
+            return;
+
+        // one run through all levels, so every level's quadrics and error still refer to the full mesh
+        std::vector<std::vector<unsigned int> > levels;
+        std::vector<float> errors;
+        simplify(indices, positions, normals, texCoords, targets, levels, errors);
+        size_t previous = indices.size();
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            std::vector<unsigned int>& simplified = levels[level];
+            // stuck on locked vertices, the level would cost memory without saving much
+            if (simplified.size() * 4 > previous * 3)
+                break;
+            MeshOptimizer::OptimizeVertexCache(simplified, positions.size());
+            MeshLod lod = { (unsigned int)indices.size(), (unsigned int)simplified.size(), errors[level] };
+            lods.push_back(lod);
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+            previous = simplified.size();
+        }
+    }
+
+private:
+    // collapses indices down through targets, from the largest. levels and errors receive one snapshot per target, the
+    // error being the largest distance in the units of positions any collapse so far moved the surface by
+    static void simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+                         const std::vector<glm::vec2>& texCoords, const std::vector<size_t>& targets, std::vector<std::vector<unsigned int> >& levels, std::vector<float>& errors)
+    {
+        size_t vertexCount = positions.size();
+        std::vector<unsigned int> result(indices);
+        if (vertexCount == 0)
+        {
+            levels.assign(targets.size(), result);
+            errors.assign(targets.size(), 0.0f);
+            return;
+        }
+
+        // work in a unit box so the geometric and attribute costs are on comparable scales
+        AABB bounds;
+        for (size_t v = 0; v < vertexCount; v++)
+            bounds.Extend(positions[v]);
+        glm::vec3 size = bounds.Max - bounds.Min;
+        float extent = std::max(size.x, std::max(size.y, size.z));
+        float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+        std::vector<glm::vec3> points(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            points[v] = (positions[v] - bounds.Min) * scale;
+
+        std::vector<unsigned int> canonical, twins;
+        std::vector<unsigned char> kinds;
+        classifyVertices(indices, positions, canonical, kinds, twins);
+
+        // area weighted plane quadrics of the original triangles
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            const glm::vec3& p0 = points[indices[t]];
+            glm::vec3 normal = glm::cross(points[indices[t + 1]] - p0, points[indices[t + 2]] - p0);
+            float length = glm::length(normal);
+            if (length <= 0.0f)
+                continue;
+            Quadric plane = Quadric::Plane(normal / length, p0, length * 0.5f);
+            for (int k = 0; k < 3; k++)
+                quadrics[indices[t + k]].Add(plane);
+        }
+        std::vector<Quadric> edgeQuadrics(vertexCount);
+        addEdgeQuadrics(indices, points, canonical, edgeQuadrics);
+
+        double maxError = 0.0;
+        std::vector<unsigned int> offsets, adjacency;
+        std::vector<Collapse> candidates;
+        std::vector<unsigned char> touched(vertexCount);
+        std::vector<unsigned int> remap(vertexCount);
+        size_t target = 0;
+        while (target < targets.size())
+        {
+            // snapshot every level the run got down to
+            if (result.size() <= targets[target])
+            {
+                levels.push_back(result);
+                errors.push_back((float)std::sqrt(maxError) / scale);
+                target++;
+                continue;
+            }
+
+            buildAdjacency(result, vertexCount, offsets, adjacency);
+
+            // both directions of every edge the vertex kinds allow, cheapest first
+            candidates.clear();
+            for (size_t t = 0; t + 2 < result.size(); t += 3)
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int a = result[t + k], b = result[t + (k + 1) % 3];
+                    Collapse candidate;
+                    if (allowed(a, b, result, offsets, adjacency, canonical, kinds, twins, quadrics, edgeQuadrics, points, normals, texCoords, candidate))
+                        candidates.push_back(candidate);
+                    if (allowed(b, a, result, offsets, adjacency, canonical, kinds, twins, quadrics, edgeQuadrics, points, normals, texCoords, candidate))
+                        candidates.push_back(candidate);
+                }
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            // collapses of one pass never share a triangle, so each one is checked against the surface it changes
+            std::fill(touched.begin(), touched.end(), 0);
+            for (size_t v = 0; v < vertexCount; v++)
+                remap[v] = (unsigned int)v;
+            size_t trianglesToRemove = (result.size() - targets[target]) / 3;
+            size_t removed = 0;
+            for (size_t c = 0; c < candidates.size() && removed < trianglesToRemove; c++)
+            {
+                const Collapse& candidate = candidates[c];
+                unsigned int a = candidate.from, b = candidate.to;
+                bool seam = candidate.twinFrom != NO_TWIN;
+                if (touched[a] || touched[b] || flips(a, b, result, offsets, adjacency, points))
+                    continue;
+                if (seam && (touched[candidate.twinFrom] || touched[candidate.twinTo] || flips(candidate.twinFrom, candidate.twinTo, result, offsets, adjacency, points)))
+                    continue;
+                removed += apply(a, b, result, offsets, adjacency, touched, remap, quadrics, edgeQuadrics);
+                if (seam)
+                    removed += apply(candidate.twinFrom, candidate.twinTo, result, offsets, adjacency, touched, remap, quadrics, edgeQuadrics);
+                maxError = std::max(maxError, candidate.distanceSquared);
+            }
+            // only locked vertices or flipping collapses are left, the remaining levels are all this one
+            if (removed == 0)
+            {
+                levels.push_back(result);
+                errors.push_back((float)std::sqrt(maxError) / scale);
+                target++;
+                continue;
+            }
+
+            // apply the pass, the triangles around collapsed edges degenerate and are dropped
+            size_t kept = 0;
+            for (size_t t = 0; t + 2 < result.size(); t += 3)
+            {
+                unsigned int i0 = remap[result[t]], i1 = remap[result[t + 1]], i2 = remap[result[t + 2]];
+                if (i0 == i1 || i1 == i2 || i0 == i2)
+                    continue;
+                result[kept++] = i0;
+                result[kept++] = i1;
+                result[kept++] = i2;
+            }
+            result.resize(kept);
+        }
+    }
+
+    // plane quadric, the symmetric 4x4 matrix as its upper triangle. weight is the area it was accumulated over
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+        double weight = 0;
+
+        static Quadric Plane(const glm::vec3& normal, const glm::vec3& point, float area)
+        {
+            double a = normal.x, b = normal.y, c = normal.z, d = -glm::dot(normal, point);
+            Quadric q;
+            q.a00 = a * a * area; q.a01 = a * b * area; q.a02 = a * c * area; q.a03 = a * d * area;
+            q.a11 = b * b * area; q.a12 = b * c * area; q.a13 = b * d * area;
+            q.a22 = c * c * area; q.a23 = c * d * area;
+            q.a33 = d * d * area;
+            q.weight = area;
+            return q;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+        }
+
+        // area weighted sum of squared distances from p to the planes
+        double Error(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                     + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                     + a22 * z * z + 2 * a23 * z
+                     + a33;
+            return std::max(e, 0.0);
+        }
+    };
+
+    // what a vertex may collapse along, from its position on the welded mesh
+    enum VertexKind
+    {
+        VERTEX_MANIFOLD,
+        // on one open border, slides along it
+        VERTEX_BORDER,
+        // one of the two vertices on an attribute seam, slides along it with its twin
+        VERTEX_SEAM,
+        // where borders or seams meet or branch, never moves
+        VERTEX_LOCKED
+    };
+
+    static const unsigned int NO_TWIN = 0xffffffffu;
+
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        // the other side of a seam collapse, moved in the same step, or NO_TWIN
+        unsigned int twinFrom;
+        unsigned int twinTo;
+        double cost;
+        // mean squared distance of the moved surface, in the unit box
+        double distanceSquared;
+    };
+
+    static Collapse collapse(unsigned int from, unsigned int to, const std::vector<Quadric>& quadrics, const std::vector<Quadric>& edgeQuadrics, const std::vector<glm::vec3>& points,
+                             const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords)
+    {
+        // how much a normal or uv change counts against squared distance in the unit box
+        const double ATTRIBUTE_WEIGHT = 0.001;
+        const Quadric& q = quadrics[from];
+        double error = q.Error(points[to]);
+        glm::vec3 normalDelta = normals[from] - normals[to];
+        glm::vec2 uvDelta = texCoords[from] - texCoords[to];
+        double attribute = ATTRIBUTE_WEIGHT * q.weight * (glm::dot(normalDelta, normalDelta) + glm::dot(uvDelta, uvDelta));
+        double edge = edgeQuadrics[from].Error(points[to]);
+        Collapse result = { from, to, NO_TWIN, NO_TWIN, error + edge + attribute, q.weight > 0.0 ? error / q.weight : 0.0 };
+        return result;
+    }
+
+    // whether from may collapse onto its neighbour to, with the cost in result. border vertices only move along a border
+    // edge, seam vertices only along a seam edge whose twin edge exists, so both sides of the seam move together
+    static bool allowed(unsigned int from, unsigned int to, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets,
+                        const std::vector<unsigned int>& adjacency, const std::vector<unsigned int>& canonical, const std::vector<unsigned char>& kinds,
+                        const std::vector<unsigned int>& twins, const std::vector<Quadric>& quadrics, const std::vector<Quadric>& edgeQuadrics, const std::vector<glm::vec3>& points,
+                        const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords, Collapse& result)
+    {
+        unsigned char kind = kinds[from];
+        if (kind == VERTEX_LOCKED)
+            return false;
+        if (kind == VERTEX_MANIFOLD)
+        {
+            result = collapse(from, to, quadrics, edgeQuadrics, points, normals, texCoords);
+            return true;
+        }
+        // an edge of the welded mesh with one triangle on this side, and the target on the same line
+        unsigned char targetKind = kinds[to];
+        if (targetKind != kind && targetKind != VERTEX_LOCKED)
+            return false;
+        unsigned int found = NO_TWIN;
+        if (sharedTriangles(from, canonical[to], indices, offsets, adjacency, canonical, found) != 1)
+            return false;
+        result = collapse(from, to, quadrics, edgeQuadrics, points, normals, texCoords);
+        if (kind == VERTEX_BORDER)
+            return true;
+
+        // the twin has to reach a different vertex at the target's position through a single triangle too
+        unsigned int twinFrom = twins[from], twinTo = NO_TWIN;
+        if (sharedTriangles(twinFrom, canonical[to], indices, offsets, adjacency, canonical, twinTo) != 1 || twinTo == to)
+            return false;
+        Collapse twin = collapse(twinFrom, twinTo, quadrics, edgeQuadrics, points, normals, texCoords);
+        result.twinFrom = twinFrom;
+        result.twinTo = twinTo;
+        result.cost += twin.cost;
+        result.distanceSquared = std::max(result.distanceSquared, twin.distanceSquared);
+        return true;
+    }
+
+    // number of triangles around vertex that have a vertex at position (a canonical vertex). found receives that vertex
+    static unsigned int sharedTriangles(unsigned int vertex, unsigned int position, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets,
+                                        const std::vector<unsigned int>& adjacency, const std::vector<unsigned int>& canonical, unsigned int& found)
+    {
+        unsigned int count = 0;
+        for (unsigned int i = offsets[vertex]; i < offsets[vertex + 1]; i++)
+        {
+            const unsigned int* triangle = &indices[adjacency[i] * 3];
+            for (int k = 0; k < 3; k++)
+                if (triangle[k] != vertex && canonical[triangle[k]] == position)
+                {
+                    found = triangle[k];
+                    count++;
+                }
+        }
+        return count;
+    }
+
+    // moves from onto to: marks the triangles around from as touched, merges the quadrics and returns how many triangles
+    // degenerate
+    static size_t apply(unsigned int from, unsigned int to, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets,
+                        const std::vector<unsigned int>& adjacency, std::vector<unsigned char>& touched, std::vector<unsigned int>& remap, std::vector<Quadric>& quadrics,
+                        std::vector<Quadric>& edgeQuadrics)
+    {
+        size_t removed = 0;
+        for (unsigned int i = offsets[from]; i < offsets[from + 1]; i++)
+        {
+            const unsigned int* triangle = &indices[adjacency[i] * 3];
+            for (int k = 0; k < 3; k++)
+                touched[triangle[k]] = 1;
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                removed++;
+        }
+        remap[from] = to;
+        quadrics[to].Add(quadrics[from]);
+        edgeQuadrics[to].Add(edgeQuadrics[from]);
+        return removed;
+    }
+
+    // kinds of every vertex: canonical maps each vertex to the first one with its position (the welded mesh), twins the
+    // other vertex of a seam vertex
+    static void classifyVertices(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, std::vector<unsigned int>& canonical,
+                                 std::vector<unsigned char>& kinds, std::vector<unsigned int>& twins)
+    {
+        size_t vertexCount = positions.size();
+        std::vector<unsigned int> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            order[v] = (unsigned int)v;
+        std::sort(order.begin(), order.end(), [&positions](unsigned int x, unsigned int y)
+        {
+            const glm::vec3& p = positions[x];
+            const glm::vec3& q = positions[y];
+            if (p.x != q.x) return p.x < q.x;
+            if (p.y != q.y) return p.y < q.y;
+            if (p.z != q.z) return p.z < q.z;
+            return x < y;
+        });
+        canonical.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            bool same = i > 0 && positions[order[i]] == positions[order[i - 1]];
+            canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+        }
+
+        // vertices the triangles use at each position, and the last two of them
+        std::vector<unsigned int> wedges(vertexCount, 0);
+        twins.assign(vertexCount, (unsigned int)NO_TWIN);
+        std::vector<unsigned char> used(vertexCount, 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            used[indices[i]] = 1;
+        std::vector<unsigned int> first(vertexCount, (unsigned int)NO_TWIN);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            if (!used[v])
+                continue;
+            unsigned int position = canonical[v];
+            if (wedges[position]++ == 0)
+                first[position] = (unsigned int)v;
+            else
+            {
+                twins[v] = first[position];
+                twins[first[position]] = (unsigned int)v;
+            }
+        }
+
+        // an edge without its reverse on the welded mesh is a border, one whose reverse only exists on the welded mesh is
+        // a seam. a vertex on a single border has two border edges, on a single seam four (two per side)
+        std::unordered_set<uint64_t> edges, weldedEdges;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                edges.insert(edgeKey(a, b));
+                weldedEdges.insert(edgeKey(canonical[a], canonical[b]));
+            }
+        std::vector<unsigned int> borderEdges(vertexCount, 0), seamEdges(vertexCount, 0);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                if (weldedEdges.find(edgeKey(canonical[b], canonical[a])) == weldedEdges.end())
+                {
+                    borderEdges[canonical[a]]++;
+                    borderEdges[canonical[b]]++;
+                }
+                else if (edges.find(edgeKey(b, a)) == edges.end())
+                {
+                    seamEdges[canonical[a]]++;
+                    seamEdges[canonical[b]]++;
+                }
+            }
+
+        kinds.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            unsigned int position = canonical[v];
+            unsigned int borders = borderEdges[position], seams = seamEdges[position];
+            if (wedges[position] == 1 && borders == 0 && seams == 0)
+                kinds[v] = VERTEX_MANIFOLD;
+            else if (wedges[position] == 1 && borders == 2 && seams == 0)
+                kinds[v] = VERTEX_BORDER;
+            else if (wedges[position] == 2 && borders == 0 && seams == 4)
+                kinds[v] = VERTEX_SEAM;
+            else
+                kinds[v] = VERTEX_LOCKED;
+        }
+    }
+
+    // planes through every border and seam edge, upright on its triangle, so moving off the line costs like moving off
+    // the surface. they only add to the cost, the distance of a collapse stays the one from the surface
+    static void addEdgeQuadrics(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& points, const std::vector<unsigned int>& canonical,
+                                std::vector<Quadric>& quadrics)
+    {
+        // how much an edge plane counts against the surface, per squared edge length
+        const float EDGE_WEIGHT = 10.0f;
+        std::unordered_set<uint64_t> edges;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+                edges.insert(edgeKey(indices[t + k], indices[t + (k + 1) % 3]));
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            const glm::vec3& p0 = points[indices[t]];
+            glm::vec3 normal = glm::cross(points[indices[t + 1]] - p0, points[indices[t + 2]] - p0);
+            if (glm::dot(normal, normal) <= 0.0f)
+                continue;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                // interior edges have their reverse on the same vertices
+                if (edges.find(edgeKey(b, a)) != edges.end() || canonical[a] == canonical[b])
+                    continue;
+                glm::vec3 edge = points[b] - points[a];
+                glm::vec3 upright = glm::cross(edge, normal);
+                float length = glm::length(upright);
+                if (length <= 0.0f)
+                    continue;
+                Quadric plane = Quadric::Plane(upright / length, points[a], EDGE_WEIGHT * glm::dot(edge, edge));
+                quadrics[a].Add(plane);
+                quadrics[b].Add(plane);
+            }
+        }
+    }
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return ((uint64_t)a << 32) | b;
+    }
+
+    // triangles around every vertex of indices
+    static void buildAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount, std::vector<unsigned int>& offsets, std::vector<unsigned int>& adjacency)
+    {
+        offsets.assign(vertexCount + 1, 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            offsets[indices[i] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(indices.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    // true when moving from onto to turns any remaining triangle too far, or upside down
+    static bool flips(unsigned int from, unsigned int to, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets,
+                      const std::vector<unsigned int>& adjacency, const std::vector<glm::vec3>& points)
+    {
+        for (unsigned int i = offsets[from]; i < offsets[from + 1]; i++)
+        {
+            const unsigned int* triangle = &indices[adjacency[i] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; k++)
+            {
+                before[k] = points[triangle[k]];
+                after[k] = triangle[k] == from ? points[to] : before[k];
+            }
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            // more than about 75 degrees is refused, so a few collapses in a row cannot turn a triangle over either.
+            // already degenerate triangles (like the poles of a uv sphere) have no side to flip to
+            float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+            if (glm::dot(normalBefore, normalBefore) > 0.0f && glm::dot(normalBefore, normalAfter) <= 0.25f * lengths)
+                return true;
+        }
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,270 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// A small cluster of connected triangles, drawn as one indirect command so it can be culled on its own. Besides its range
+// of the index buffer it keeps a bounding sphere and a normal cone in object space: every triangle normal lies within the
+// cone around ConeAxis, whose half angle has the sine ConeCutoff. A camera that sees all of the sphere from behind every
+// normal of the cone sees only back faces (Shirman and Abi-Ezzi, "The Cone of Normals Technique for Fast Processing of
+// Curved Patches").
+struct Meshlet
+{
+    BoundingSphere Sphere;
+    glm::vec3 ConeAxis;
+    // 1 when the triangles face too many ways for the cone to ever cull
+    float ConeCutoff;
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+    uint32_t VertexCount;
+    uint32_t Padding;
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet is cached as it is");
+
+// true when every triangle of meshlet faces away from camera, both in the object space of the meshlet. facing survives
+// any affine transform, so testing against the camera moved into object space is exact for scaled and sheared instances.
+// the same test as in meshlet_cull.comp
+// ------------------------------------------------------------------------
+inline bool meshletBackfacing(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff, const glm::vec3& camera)
+{
+    if (coneCutoff >= 1.0f)
+        return false;
+    // every point of the sphere has to be seen at more than 90 degrees minus the cone angle from the axis, the radius
+    // term covers both the offset of the point and the longer distance to it
+    glm::vec3 view = center - camera;
+    return glm::dot(view, coneAxis) >= coneCutoff * glm::length(view) + radius * (1.0f + coneCutoff);
+}
+
+// Splits a triangle list into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles, the sizes mesh shader
+// pipelines use. A meshlet grows from a seed over shared vertices, taking the triangle that adds the fewest new vertices
+// and, of those, the one closest to the average normal so far, so meshlets stay compact and their cones narrow.
+class MeshletBuilder
+{
+public:
+    static const unsigned int MAX_VERTICES = 64;
+    static const unsigned int MAX_TRIANGLES = 124;
+
+    // reorders the first indexCount indices so every meshlet is one contiguous range and appends the meshlets.
+    // FirstIndex counts from the start of indices
+    // ------------------------------------------------------------------------
+    static void Build(std::vector<unsigned int>& indices, size_t indexCount, const std::vector<glm::vec3>& positions, std::vector<Meshlet>& meshlets)
+    {
+        const unsigned int none = ~0u;
+        size_t triangleCount = indexCount / 3;
+        size_t vertexCount = positions.size();
+        if (triangleCount == 0)
+            return;
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3& p0 = positions[indices[t * 3]];
+            glm::vec3 normal = glm::cross(positions[indices[t * 3 + 1]] - p0, positions[indices[t * 3 + 2]] - p0);
+            float length = glm::length(normal);
+            normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        }
+
+        // triangles around every position. vertices split by uv or normal seams share one, so meshlets grow across seams
+        std::vector<unsigned int> welded = weld(positions);
+        std::vector<unsigned int> offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            offsets[welded[indices[i]] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[fill[welded[indices[i]]]++] = (unsigned int)(i / 3);
+
+        std::vector<unsigned char> emitted(triangleCount, 0);
+        // the meshlet a vertex was last added to, a position was last grown from, or a triangle last became a candidate of
+        std::vector<unsigned int> vertexMeshlet(vertexCount, none), positionMeshlet(vertexCount, none), candidateMeshlet(triangleCount, none);
+        std::vector<unsigned int> ordered;
+        ordered.reserve(indexCount);
+        std::vector<unsigned int> candidates, triangles;
+        size_t seed = 0;
+        while (true)
+        {
+            // the next triangle in the incoming order starts the next meshlet, so meshlets follow the cache and overdraw order
+            while (seed < triangleCount && emitted[seed])
+                seed++;
+            if (seed == triangleCount)
+                break;
+            unsigned int id = (unsigned int)meshlets.size();
+            unsigned int vertices = 0;
+            glm::vec3 normalSum(0.0f);
+            triangles.clear();
+            candidates.clear();
+            candidates.push_back((unsigned int)seed);
+            candidateMeshlet[seed] = id;
+
+            while (triangles.size() < MAX_TRIANGLES)
+            {
+                // fewest new vertices first, then the closest normal
+                size_t best = candidates.size();
+                unsigned int bestNew = 4;
+                float bestDot = -2.0f;
+                for (size_t c = 0; c < candidates.size(); c++)
+                {
+                    unsigned int t = candidates[c];
+                    if (emitted[t])
+                        continue;
+                    unsigned int added = 0;
+                    for (int k = 0; k < 3; k++)
+                        added += vertexMeshlet[indices[t * 3 + k]] != id;
+                    if (vertices + added > MAX_VERTICES)
+                        continue;
+                    float agreement = glm::dot(normals[t], normalSum);
+                    if (added < bestNew || (added == bestNew && agreement > bestDot))
+                    {
+                        best = c;
+                        bestNew = added;
+                        bestDot = agreement;
+                    }
+                }
+                if (best == candidates.size())
+                    break;
+
+                unsigned int t = candidates[best];
+                candidates[best] = candidates.back();
+                candidates.pop_back();
+                emitted[t] = 1;
+                triangles.push_back(t);
+                normalSum += normals[t];
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = indices[t * 3 + k];
+                    if (vertexMeshlet[v] != id)
+                    {
+                        vertexMeshlet[v] = id;
+                        vertices++;
+                    }
+                    unsigned int position = welded[v];
+                    if (positionMeshlet[position] == id)
+                        continue;
+                    positionMeshlet[position] = id;
+                    for (unsigned int i = offsets[position]; i < offsets[position + 1]; i++)
+                    {
+                        unsigned int neighbour = adjacency[i];
+                        if (!emitted[neighbour] && candidateMeshlet[neighbour] != id)
+                        {
+                            candidateMeshlet[neighbour] = id;
+                            candidates.push_back(neighbour);
+                        }
+                    }
+                }
+            }
+
+            Meshlet meshlet = {};
+            meshlet.FirstIndex = (uint32_t)ordered.size();
+            meshlet.IndexCount = (uint32_t)triangles.size() * 3;
+            meshlet.VertexCount = vertices;
+            for (size_t i = 0; i < triangles.size(); i++)
+                for (int k = 0; k < 3; k++)
+                    ordered.push_back(indices[triangles[i] * 3 + k]);
+            computeBounds(meshlet, ordered, positions, normals, triangles);
+            meshlets.push_back(meshlet);
+        }
+        std::copy(ordered.begin(), ordered.end(), indices.begin());
+    }
+
+    // runs the vertex cache pass of MeshOptimizer inside every meshlet. Build takes triangles in the order it grows the
+    // meshlet, which throws away the cache order of the whole mesh. the overdraw order survives between meshlets, they are
+    // seeded in it, and sorting inside one only costs cache for no gain at that size
+    // ------------------------------------------------------------------------
+    static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, const std::vector<Meshlet>& meshlets)
+    {
+        const unsigned int none = ~0u;
+        // the meshlet's own vertex numbering, so the passes only touch its at most MAX_VERTICES vertices
+        std::vector<unsigned int> local(vertexCount, none), vertices, meshletIndices;
+        for (size_t m = 0; m < meshlets.size(); m++)
+        {
+            const Meshlet& meshlet = meshlets[m];
+            vertices.clear();
+            meshletIndices.clear();
+            for (uint32_t i = 0; i < meshlet.IndexCount; i++)
+            {
+                unsigned int vertex = indices[meshlet.FirstIndex + i];
+                if (local[vertex] == none)
+                {
+                    local[vertex] = (unsigned int)vertices.size();
+                    vertices.push_back(vertex);
+                }
+                meshletIndices.push_back(local[vertex]);
+            }
+            MeshOptimizer::OptimizeVertexCache(meshletIndices, vertices.size());
+            for (uint32_t i = 0; i < meshlet.IndexCount; i++)
+                indices[meshlet.FirstIndex + i] = vertices[meshletIndices[i]];
+            for (size_t v = 0; v < vertices.size(); v++)
+                local[vertices[v]] = none;
+        }
+    }
+
+private:
+    // the lowest vertex with the same position, for every vertex
+    static std::vector<unsigned int> weld(const std::vector<glm::vec3>& positions)
+    {
+        std::vector<unsigned int> order(positions.size());
+        for (size_t v = 0; v < positions.size(); v++)
+            order[v] = (unsigned int)v;
+        std::sort(order.begin(), order.end(), [&positions](unsigned int x, unsigned int y)
+        {
+            const glm::vec3& p = positions[x];
+            const glm::vec3& q = positions[y];
+            if (p.x != q.x) return p.x < q.x;
+            if (p.y != q.y) return p.y < q.y;
+            if (p.z != q.z) return p.z < q.z;
+            return x < y;
+        });
+        std::vector<unsigned int> welded(positions.size());
+        for (size_t i = 0; i < order.size(); i++)
+            welded[order[i]] = i > 0 && positions[order[i]] == positions[order[i - 1]] ? welded[order[i - 1]] : order[i];
+        return welded;
+    }
+
+    static void computeBounds(Meshlet& meshlet, const std::vector<unsigned int>& ordered, const std::vector<glm::vec3>& positions,
+                              const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& triangles)
+    {
+        AABB box;
+        for (uint32_t i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; i++)
+            box.Extend(positions[ordered[i]]);
+        meshlet.Sphere.Center = box.Center();
+        meshlet.Sphere.Radius = 0.0f;
+        for (uint32_t i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; i++)
+            meshlet.Sphere.Radius = std::max(meshlet.Sphere.Radius, glm::length(positions[ordered[i]] - meshlet.Sphere.Center));
+
+        // the axis is the average normal, the cone has to reach the normal furthest from it. degenerate triangles
+        // draw nothing and do not count
+        glm::vec3 axis(0.0f);
+        for (size_t i = 0; i < triangles.size(); i++)
+            axis += normals[triangles[i]];
+        float length = glm::length(axis);
+        meshlet.ConeAxis = length > 0.0f ? axis / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.ConeCutoff = 1.0f;
+        if (length <= 0.0f)
+            return;
+        float minDot = 1.0f;
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            const glm::vec3& normal = normals[triangles[i]];
+            if (normal != glm::vec3(0.0f))
+                minDot = std::min(minDot, glm::dot(normal, meshlet.ConeAxis));
+        }
+        // a cone of 90 degrees or more holds triangles facing the camera from everywhere
+        if (minDot <= 0.0f)
+            return;
+        // a little wider than the triangles need, the renderer draws positions quantized to 16 bits and tiny triangles
+        // can turn by a fraction of a degree
+        const float CONE_SLACK = 0.02f;
+        meshlet.ConeCutoff = std::min(std::sqrt(std::max(1.0f - minDot * minDot, 0.0f)) + CONE_SLACK, 1.0f);
+    }
+};
+#endif
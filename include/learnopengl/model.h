@@ -11,6 +11,8 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
 #include <learnopengl/shader.h>
 
 #include <string>
@@ -18,6 +20,7 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <algorithm>
 #include <vector>
 using namespace std;
 
@@ -29,6 +32,7 @@ public:
     /*  Model Data */
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh> meshes;
+    vector<string> materials;    // material names of the scene, Mesh::Material indexes them
     string directory;
     bool gammaCorrection;
 
@@ -39,12 +43,66 @@ public:
         loadModel(path);
     }
 
+    // a model owns the GL objects of its meshes, pass it by reference
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default;
+    Model& operator=(Model&&) = default;
+
     // draws the model, and thus all its meshes
-    void Draw(Shader shader)
+    void Draw(const Shader& shader)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // draws all meshes with one per-object record, see Mesh::Draw(unsigned int)
+    void Draw(unsigned int baseInstance)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(baseInstance);
+    }
+
+    // runs the MeshOptimizer stages on one mesh, groups the full level into meshlets, appends the levels of detail to
+    // indices and reports the simulated cache efficiency of the full level after every stage and the size of every level.
+    // needs no GL context, tools run the import pipeline through it
+    static void optimizeMesh(const char* name, vector<Vertex>& vertices, vector<unsigned int>& indices, vector<MeshLod>& lods, vector<Meshlet>& meshlets)
+    {
+        VertexCacheStats stages[5];
+        stages[0] = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+        stages[1] = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        vector<glm::vec3> positions(vertices.size()), normals(vertices.size());
+        vector<glm::vec2> texCoords(vertices.size());
+        for(unsigned int i = 0; i < vertices.size(); i++)
+        {
+            positions[i] = vertices[i].Position;
+            normals[i] = vertices[i].Normal;
+            texCoords[i] = vertices[i].TexCoords;
+        }
+        MeshOptimizer::OptimizeOverdraw(indices, positions);
+        stages[2] = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        // every meshlet becomes one run of triangles, the meshlets themselves start in the order of the passes above
+        MeshletBuilder::Build(indices, indices.size(), positions, meshlets);
+        stages[3] = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        // the cache order inside each run is lost to Build, order the runs again
+        MeshletBuilder::OptimizeVertexCache(indices, vertices.size(), meshlets);
+        stages[4] = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+        MeshSimplifier::BuildLods(indices, positions, normals, texCoords, lods);
+        // fetch order of all levels together, the coarse ones reuse vertices of the full one
+        MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+        // import, vertex cache, overdraw, meshlets, vertex cache inside the meshlets
+        cout << "Optimized mesh " << name << ", " << lods[0].IndexCount / 3 << " triangles: ACMR";
+        for(unsigned int i = 0; i < 5; i++)
+            cout << (i > 0 ? " -> " : " ") << stages[i].acmr;
+        cout << ", ATVR";
+        for(unsigned int i = 0; i < 5; i++)
+            cout << (i > 0 ? " -> " : " ") << stages[i].atvr;
+        cout << ", " << meshlets.size() << " meshlets, LODs";
+        for(unsigned int i = 0; i < lods.size(); i++)
+            cout << " " << lods[i].IndexCount / 3;
+        cout << endl;
+    }
     
 private:
     /*  Functions   */
@@ -62,6 +120,13 @@ private:
         }
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
+        // material names, the meshes only keep an index into them
+        for(unsigned int i = 0; i < scene->mNumMaterials; i++)
+        {
+            aiString name;
+            scene->mMaterials[i]->Get(AI_MATKEY_NAME, name);
+            materials.push_back(name.C_Str());
+        }
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
@@ -92,6 +157,7 @@ private:
         vector<Vertex> vertices;
         vector<unsigned int> indices;
         vector<Texture> textures;
+        AABB bounds;
 
         // Walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -103,6 +169,7 @@ private:
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            bounds.Extend(vector);
             // normals
             vector.x = mesh->mNormals[i].x;
             vector.y = mesh->mNormals[i].y;
@@ -140,6 +207,13 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // reorder for the post-transform cache, then against overdraw, cut into meshlets, add the simplified levels, then the
+        // vertices in fetch order. only for pure triangle lists
+        vector<MeshLod> lods;
+        vector<Meshlet> meshlets;
+        if(indices.size() == mesh->mNumFaces * 3)
+            optimizeMesh(mesh->mName.C_Str(), vertices, indices, lods, meshlets);
+
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -162,8 +236,19 @@ private:
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
+        // bounding sphere around the center of the box, tighter than the sphere around the box itself
+        BoundingSphere sphere;
+        sphere.Center = bounds.Center();
+        for(unsigned int i = 0; i < vertices.size(); i++)
+            sphere.Radius = std::max(sphere.Radius, glm::length(vertices[i].Position - sphere.Center));
+
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        Mesh result(vertices, indices, textures, lods);
+        result.Bounds = bounds;
+        result.Sphere = sphere;
+        result.Material = mesh->mMaterialIndex;
+        result.Meshlets = std::move(meshlets);
+        return result;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -0,0 +1,141 @@
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Compact vertex layouts read by pbr.vs, instead of the 56 bytes of full floats in Vertex:
+//   normal     octahedral, 2 x snorm16
+//   tangent    octahedral, 2 x snorm16, the bitangent sign is the sign of the second component
+//   texCoords  2 x half
+// PackedVertex keeps the position as 3 floats (24 bytes). QuantizedVertex stores it as unorm16 against the bounds of
+// its geometry (20 bytes), pbr.vs maps it back with the scale and offset of a PositionQuantization in the object record.
+
+// octahedral encoding of a unit vector into [-1, 1]^2 (Meyer et al., "On Floating-Point Normal Vectors")
+// ------------------------------------------------------------------------
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (length <= 0.0f)
+        return glm::vec2(0.0f);
+    n /= length;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return e;
+}
+
+// inverse of octEncode, the same as octDecode in pbr.vs
+// ------------------------------------------------------------------------
+inline glm::vec3 octDecode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+inline uint32_t packNormal(const glm::vec3& normal)
+{
+    return glm::packSnorm2x16(octEncode(normal));
+}
+
+// tangent.w is the bitangent sign (bitangent = cross(normal, tangent) * w). the second octahedral component is remapped
+// to (0, 1] and takes the sign, which costs it one bit
+// ------------------------------------------------------------------------
+inline uint32_t packTangent(const glm::vec4& tangent)
+{
+    glm::vec2 e = octEncode(glm::vec3(tangent));
+    e.y = std::max(e.y * 0.5f + 0.5f, 1.0f / 32767.0f) * (tangent.w < 0.0f ? -1.0f : 1.0f);
+    return glm::packSnorm2x16(e);
+}
+
+// the tangent of packTangent from the tangent and bitangent of a loader, made orthogonal to normal
+// ------------------------------------------------------------------------
+inline glm::vec4 tangentFrame(const glm::vec3& normal, const glm::vec3& tangent, const glm::vec3& bitangent)
+{
+    glm::vec3 t = tangent - normal * glm::dot(normal, tangent);
+    float length = glm::length(t);
+    t = length > 0.0f ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+    return glm::vec4(t, glm::dot(glm::cross(normal, t), bitangent) < 0.0f ? -1.0f : 1.0f);
+}
+
+// maps unorm16 positions back into object space: position = Offset + Scale * quantized, with quantized in [0, 1].
+// the default is the identity, for float positions
+struct PositionQuantization
+{
+    glm::vec3 Offset = glm::vec3(0.0f);
+    glm::vec3 Scale = glm::vec3(1.0f);
+
+    PositionQuantization() {}
+
+    // spans bounds, an empty box gives the identity
+    explicit PositionQuantization(const AABB& bounds)
+    {
+        if (bounds.Empty())
+            return;
+        Offset = bounds.Min;
+        Scale = bounds.Max - bounds.Min;
+    }
+
+    void Quantize(const glm::vec3& position, uint16_t out[4]) const
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            float unit = Scale[i] > 0.0f ? (position[i] - Offset[i]) / Scale[i] : 0.0f;
+            out[i] = (uint16_t)std::lround(glm::clamp(unit, 0.0f, 1.0f) * 65535.0f);
+        }
+        out[3] = 0;
+    }
+};
+
+struct PackedVertex
+{
+    glm::vec3 Position;
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint32_t TexCoords;
+
+    static PackedVertex Pack(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& tangent, const glm::vec2& texCoords)
+    {
+        PackedVertex vertex;
+        vertex.Position = position;
+        vertex.Normal = packNormal(normal);
+        vertex.Tangent = packTangent(tangent);
+        vertex.TexCoords = glm::packHalf2x16(texCoords);
+        return vertex;
+    }
+};
+
+struct QuantizedVertex
+{
+    // xyz, w is padding
+    uint16_t Position[4];
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint32_t TexCoords;
+
+    static QuantizedVertex Pack(const PositionQuantization& quantization, const glm::vec3& position, const glm::vec3& normal, const glm::vec4& tangent, const glm::vec2& texCoords)
+    {
+        QuantizedVertex vertex;
+        quantization.Quantize(position, vertex.Position);
+        vertex.Normal = packNormal(normal);
+        vertex.Tangent = packTangent(tangent);
+        vertex.TexCoords = glm::packHalf2x16(texCoords);
+        return vertex;
+    }
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex is uploaded as it is");
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex is uploaded and cached as it is");
+#endif
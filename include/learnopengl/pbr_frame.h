@@ -0,0 +1,255 @@
+#ifndef PBR_FRAME_H
+#define PBR_FRAME_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_data.h>
+#include <learnopengl/frame_ring.h>
+#include <learnopengl/frustum_culler.h>
+#include <learnopengl/indirect_renderer.h>
+#include <learnopengl/light_buffer.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/scene_bvh.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/texture_loader.h>
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// mirrors PbrMaterial in pbr.fs (std430, inside Object_Info)
+struct PbrMaterial
+{
+    GLuint64 albedoMap;
+    GLuint64 normalMap;
+    GLuint64 metallicMap;
+    GLuint64 roughnessMap;
+    GLuint64 aoMap;
+    GLuint64 ormMap;
+    GLuint packedORM;
+    GLuint padding[3];
+};
+
+// one record of the per-frame object ring, mirrors Object_Info in pbr.vs and pbr.fs (std430)
+struct Object_Info
+{
+    glm::mat4 model;
+    // PositionQuantization of the geometry, w unused
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+    PbrMaterial material;
+};
+
+// texture loader ids of one material. a packed material loads a single ormMap and the three split ids point at it too
+struct MaterialMaps
+{
+    unsigned int albedoMap;
+    unsigned int normalMap;
+    unsigned int metallicMap;
+    unsigned int roughnessMap;
+    unsigned int aoMap;
+    unsigned int ormMap;
+    bool packedORM;
+    bool hasNormalMap;
+};
+
+// what is drawn for one instance of the scene bvh, indexed by instance id
+struct SceneObject
+{
+    unsigned int geometry;
+    // pbr shader permutation of the material, also the draw batch
+    unsigned int permutation;
+    const MaterialMaps* maps;
+    std::string name;
+};
+
+// queues the maps of one material. the packed path is taken when ormPath exists
+// ------------------------------------------------------------------------
+inline MaterialMaps loadMaterialMaps(TextureLoader& loader, const std::string& albedoPath, const std::string& normalPath, const std::string& metallicPath, const std::string& roughnessPath, const std::string& aoPath, const std::string& ormPath)
+{
+    // placeholders for albedo, normal, metallic, roughness, ao and orm
+    static const glm::vec4 placeholderColors[6] = { glm::vec4(0.5f, 0.5f, 0.5f, 1.0f), glm::vec4(0.5f, 0.5f, 1.0f, 1.0f), glm::vec4(0.0f), glm::vec4(0.5f), glm::vec4(1.0f), glm::vec4(1.0f, 0.5f, 0.0f, 1.0f) };
+
+    MaterialMaps maps;
+    maps.albedoMap = loader.Load(albedoPath, placeholderColors[0]);
+    // without a normal map the material is drawn with the vertex normal and never samples normalMap
+    maps.hasNormalMap = std::ifstream(normalPath).good();
+    maps.normalMap = maps.hasNormalMap ? loader.Load(normalPath, placeholderColors[1]) : maps.albedoMap;
+    maps.packedORM = std::ifstream(ormPath).good();
+    if (maps.packedORM)
+    {
+        maps.ormMap = loader.Load(ormPath, placeholderColors[5]);
+        maps.metallicMap = maps.roughnessMap = maps.aoMap = maps.ormMap;
+    }
+    else
+    {
+        maps.metallicMap = loader.Load(metallicPath, placeholderColors[2]);
+        maps.roughnessMap = loader.Load(roughnessPath, placeholderColors[3]);
+        maps.aoMap = loader.Load(aoPath, placeholderColors[4]);
+        maps.ormMap = maps.metallicMap;
+    }
+    return maps;
+}
+
+// the current bindless handles of a material, placeholders included
+// ------------------------------------------------------------------------
+inline PbrMaterial materialHandles(const TextureLoader& loader, const MaterialMaps& maps)
+{
+    PbrMaterial material = {};
+    material.albedoMap = loader.Handle(maps.albedoMap);
+    material.normalMap = loader.Handle(maps.normalMap);
+    material.metallicMap = loader.Handle(maps.metallicMap);
+    material.roughnessMap = loader.Handle(maps.roughnessMap);
+    material.aoMap = loader.Handle(maps.aoMap);
+    material.ormMap = loader.Handle(maps.ormMap);
+    material.packedORM = maps.packedORM;
+    return material;
+}
+
+// the pbr.fs features of a material, on top of the scene wide ones
+// ------------------------------------------------------------------------
+inline std::vector<std::string> materialDefines(const MaterialMaps& maps)
+{
+    std::vector<std::string> defines;
+    if (maps.hasNormalMap)
+        defines.push_back("HAS_NORMAL_MAP");
+    if (maps.packedORM)
+        defines.push_back("PACKED_ORM");
+    return defines;
+}
+
+// writes the object record of one visible instance and queues its meshes
+// ------------------------------------------------------------------------
+inline void queueObject(FrameRing<Object_Info>& objectRing, IndirectRenderer& renderer, unsigned int geometry, unsigned int permutation, const PbrMaterial& material, const glm::mat4& model)
+{
+    PositionQuantization quantization = renderer.Quantization(geometry);
+    Object_Info object = { model, glm::vec4(quantization.Offset, 0.0f), glm::vec4(quantization.Scale, 0.0f), material };
+    renderer.Queue(geometry, objectRing.Push(object), model, permutation);
+}
+
+// One frame of the pbr scene, from finishing the decoded textures to fencing the rings: moves the animated lights,
+// binds the camera, bins the lights into clusters and queues every visible object with its material. The renderer's
+// loop and asset-pipeline frame-allocations both draw through Render(), so the allocation check sees the real frame.
+// It only holds references, the caller owns every system and moves the instances of the scene before each frame.
+class PbrFrame
+{
+public:
+    PbrFrame(TextureLoader& textureLoader, LightBuffer& lightBuffer, LightClusters& lightClusters, FrameDataBuffer& frameData, ShaderPermutations& pbrShaders,
+             FrameRing<Object_Info>& objectRing, IndirectRenderer& renderer, SceneBVH& scene, const std::vector<SceneObject>& sceneObjects)
+        : textureLoader(textureLoader), lightBuffer(lightBuffer), lightClusters(lightClusters), frameData(frameData), pbrShaders(pbrShaders),
+          objectRing(objectRing), renderer(renderer), scene(scene), sceneObjects(sceneObjects), irradianceMap(0), prefilterMap(0), brdfLUT(0)
+    {
+    }
+
+    PbrFrame(const PbrFrame&) = delete;
+    PbrFrame& operator=(const PbrFrame&) = delete;
+
+    // lights 0 to restLights.size() - 1 of the light buffer swing along x around these, they are rewritten every frame
+    // ------------------------------------------------------------------------
+    void SetAnimatedLights(const std::vector<Light_Info>& restLights)
+    {
+        animatedLights = restLights;
+    }
+
+    // bound to texture units 0, 1 and 2 for pbr.fs
+    // ------------------------------------------------------------------------
+    void SetIBL(unsigned int irradiance, unsigned int prefilter, unsigned int lut)
+    {
+        irradianceMap = irradiance;
+        prefilterMap = prefilter;
+        brdfLUT = lut;
+    }
+
+    // draws the scene from frame's camera. drawBackground runs after the objects, while frame is still bound
+    // ------------------------------------------------------------------------
+    template <typename DrawBackground>
+    void Render(const FrameData& frame, float fovY, float lodPixelError, int framebufferWidth, int framebufferHeight, DrawBackground drawBackground)
+    {
+        // finish the material maps that were decoded since the last frame
+        textureLoader.Update();
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // lights, only the animated ones are rewritten
+        for (unsigned int i = 0; i < animatedLights.size(); ++i)
+        {
+            Light_Info light = animatedLights[i];
+            light.position.x += std::sin(frame.time * 5.0f) * 5.0f;
+            lightBuffer.Set(i, light);
+        }
+        lightBuffer.Upload();
+
+        // the camera of this frame, bound before the light culling and every draw that reads it
+        frameData.BeginFrame();
+        frameData.Bind(frameData.Push(frame));
+
+        // bin this frame's lights into the clusters before anything is shaded with them
+        lightClusters.Update(lightBuffer, frame.view);
+
+        // cluster uniforms of every pbr permutation, looked up the first frame it is drawn
+        for (unsigned int i = 0; i < pbrShaders.Count(); i++)
+        {
+            if (i == pbrClusterUniforms.size())
+                pbrClusterUniforms.push_back(LightClusters::Uniforms(pbrShaders[i]));
+            pbrShaders[i].use();
+            lightClusters.SetUniforms(pbrClusterUniforms[i], framebufferWidth, framebufferHeight);
+        }
+        objectRing.BeginFrame();
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, brdfLUT);
+
+        // the instances were moved by the caller
+        scene.Refit();
+
+        // whole instances outside the view are dropped by the bvh, the renderer then culls the meshes of the rest
+        Frustum frustum = Frustum::FromMatrix(frame.viewProjection);
+        visibleInstances.clear();
+        scene.QueryFrustum(frustum, visibleInstances);
+        renderer.SetView(frame.camPos, fovY, (float)framebufferHeight, lodPixelError);
+        for (unsigned int i = 0; i < visibleInstances.size(); i++)
+        {
+            const SceneObject& object = sceneObjects[visibleInstances[i]];
+            queueObject(objectRing, renderer, object.geometry, object.permutation, materialHandles(textureLoader, *object.maps), scene.Transform(visibleInstances[i]));
+        }
+
+        // every object queued above that the camera can see, in one call per shader permutation
+        renderer.Submit(frustum, [this](unsigned int permutation) { pbrShaders[permutation].use(); });
+
+        // every draw reading this frame's object records and light lists is queued
+        objectRing.EndFrame();
+        lightClusters.EndFrame();
+
+        drawBackground();
+
+        // the background was the last draw reading this frame's FrameData
+        frameData.EndFrame();
+    }
+
+    // the instances the bvh kept in the last frame
+    const std::vector<unsigned int>& VisibleInstances() const { return visibleInstances; }
+
+private:
+    TextureLoader& textureLoader;
+    LightBuffer& lightBuffer;
+    LightClusters& lightClusters;
+    FrameDataBuffer& frameData;
+    ShaderPermutations& pbrShaders;
+    FrameRing<Object_Info>& objectRing;
+    IndirectRenderer& renderer;
+    SceneBVH& scene;
+    const std::vector<SceneObject>& sceneObjects;
+
+    std::vector<Light_Info> animatedLights;
+    unsigned int irradianceMap, prefilterMap, brdfLUT;
+    std::vector<LightClusters::ShaderUniforms> pbrClusterUniforms;
+    std::vector<unsigned int> visibleInstances;
+};
+#endif
@@ -0,0 +1,164 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// Persists a linked program with glGetProgramBinary so the next run can skip compiling and linking its GLSL.
+// The file is keyed by a hash of the stage sources (defines included) and the vendor, renderer and version strings of
+// the driver, so editing a shader or updating the driver just misses the cache and overwrites it. A driver is also free
+// to reject a binary it wrote itself, in which case Load() fails and the program is compiled from source as usual.
+class ProgramCache
+{
+public:
+    uint64_t Key;
+    std::string CachePath;
+
+    // constructor, hashes the sources of every stage with the driver strings
+    // ------------------------------------------------------------------------
+    ProgramCache(const std::string& cachePath, const std::vector<std::string>& sources)
+        : Key(FNV_OFFSET), CachePath(cachePath)
+    {
+        for (unsigned int i = 0; i < sources.size(); i++)
+        {
+            // the length keeps "ab" + "c" apart from "a" + "bc"
+            uint64_t length = sources[i].size();
+            Key = hashBytes(&length, sizeof(length), Key);
+            Key = hashBytes(sources[i].data(), sources[i].size(), Key);
+        }
+        const GLenum strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; i++)
+        {
+            const char* value = (const char*)glGetString(strings[i]);
+            if (value)
+                Key = hashBytes(value, std::char_traits<char>::length(value), Key);
+        }
+        uint32_t version = VERSION;
+        Key = hashBytes(&version, sizeof(version), Key);
+    }
+
+    // <source>.programcache, with a hash of the defines in the name so every permutation of a shader keeps its own file
+    // ------------------------------------------------------------------------
+    static std::string PathFor(const std::string& sourcePath, const std::vector<std::string>& defines)
+    {
+        if (defines.empty())
+            return sourcePath + ".programcache";
+        uint64_t hash = FNV_OFFSET;
+        for (unsigned int i = 0; i < defines.size(); i++)
+            hash = hashBytes(defines[i].c_str(), defines[i].size() + 1, hash);
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return sourcePath + "." + name + ".programcache";
+    }
+
+    // true when the driver supports program binaries at all
+    // ------------------------------------------------------------------------
+    static bool Supported()
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // loads the cached binary into program. returns false on a miss, a damaged file or a binary the driver rejects,
+    // program can then still be built from source
+    // ------------------------------------------------------------------------
+    bool Load(GLuint program)
+    {
+        if (!Supported())
+            return false;
+        std::ifstream file(CachePath, std::ios::binary);
+        if (!file)
+            return false;
+
+        uint32_t magic = 0, version = 0, format = 0, length = 0;
+        uint64_t key = 0;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&key, sizeof(key));
+        file.read((char*)&format, sizeof(format));
+        file.read((char*)&length, sizeof(length));
+        if (!file || magic != MAGIC || version != VERSION || key != Key || length == 0)
+            return false;
+
+        std::vector<char> binary(length);
+        file.read(binary.data(), length);
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::DAMAGED_FILE " << CachePath << std::endl;
+            return false;
+        }
+
+        glProgramBinary(program, format, binary.data(), (GLsizei)length);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::BINARY_REJECTED " << CachePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // writes the binary of a linked program. link with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set so the driver keeps it.
+    // a temp file is renamed over the old cache at the end, like IBLCache does
+    // ------------------------------------------------------------------------
+    void Save(GLuint program)
+    {
+        GLint success = 0, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0 || !Supported())
+            return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+
+        std::string tempPath = CachePath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            uint32_t magic = MAGIC, version = VERSION, binaryFormat = format, binaryLength = (uint32_t)written;
+            file.write((const char*)&magic, sizeof(magic));
+            file.write((const char*)&version, sizeof(version));
+            file.write((const char*)&Key, sizeof(Key));
+            file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+            file.write((const char*)&binaryLength, sizeof(binaryLength));
+            file.write(binary.data(), written);
+            if (!file)
+            {
+                std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << tempPath << std::endl;
+                return;
+            }
+        }
+        std::remove(CachePath.c_str());
+        std::rename(tempPath.c_str(), CachePath.c_str());
+    }
+
+private:
+    static const uint32_t MAGIC = 0x47525050; // "PPRG"
+    static const uint32_t VERSION = 1;
+    static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+};
+#endif
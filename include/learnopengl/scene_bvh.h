@@ -0,0 +1,361 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/frustum_culler.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+// The instances of a scene in a bounding volume hierarchy. Every instance is an object space box and a transform, the
+// tree is built over their world space boxes with the binned surface area heuristic. Moving instances only needs
+// SetTransform() and a Refit(), which keeps the shape of the tree and updates its boxes bottom up in O(n). When
+// instances drifted far from where they were at Build(), queries slow down and another Build() brings them back.
+// Frustum, ray and nearest queries walk the tree, so they cost O(log n) plus the size of the result.
+// Ray and nearest queries work on the instance boxes, exact triangle tests are left to the caller.
+class SceneBVH
+{
+public:
+    static const unsigned int MAX_LEAF_SIZE = 4;
+    static const unsigned int MAX_DEPTH = 48;
+    static const unsigned int BINS = 16;
+
+    // returns the id of the new instance, it takes part in queries after the next Build()
+    // ------------------------------------------------------------------------
+    unsigned int Add(const AABB& localBounds, const glm::mat4& transform)
+    {
+        Instance instance = { localBounds, transform };
+        instances.push_back(instance);
+        worldBounds.push_back(localBounds.Transformed(transform));
+        return (unsigned int)instances.size() - 1;
+    }
+
+    // moves an instance, call Refit() once all moves of the frame are done
+    // ------------------------------------------------------------------------
+    void SetTransform(unsigned int id, const glm::mat4& transform)
+    {
+        instances[id].transform = transform;
+        worldBounds[id] = instances[id].localBounds.Transformed(transform);
+    }
+
+    unsigned int Count() const { return (unsigned int)instances.size(); }
+    const glm::mat4& Transform(unsigned int id) const { return instances[id].transform; }
+    const AABB& Bounds(unsigned int id) const { return worldBounds[id]; }
+
+    // rebuilds the whole tree from the current world boxes
+    // ------------------------------------------------------------------------
+    void Build()
+    {
+        nodes.clear();
+        order.resize(instances.size());
+        centroids.resize(instances.size());
+        for (unsigned int i = 0; i < instances.size(); i++)
+        {
+            order[i] = i;
+            centroids[i] = worldBounds[i].Center();
+        }
+        if (instances.empty())
+            return;
+        nodes.reserve(2 * instances.size() / MAX_LEAF_SIZE + 1);
+        nodes.push_back(Node());
+        build(0, 0, (unsigned int)instances.size(), 0);
+    }
+
+    // updates every node box after SetTransform(), children always come after their parent so one backwards pass does it
+    // ------------------------------------------------------------------------
+    void Refit()
+    {
+        for (unsigned int n = (unsigned int)nodes.size(); n-- > 0;)
+        {
+            Node& node = nodes[n];
+            if (node.left == 0)
+            {
+                node.bounds = AABB();
+                for (unsigned int i = node.first; i < node.first + node.count; i++)
+                    node.bounds.Extend(worldBounds[order[i]]);
+            }
+            else
+            {
+                node.bounds = nodes[node.left].bounds;
+                node.bounds.Extend(nodes[node.left + 1].bounds);
+            }
+        }
+    }
+
+    // appends the id of every instance whose box touches the frustum
+    // ------------------------------------------------------------------------
+    void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const
+    {
+        if (nodes.empty())
+            return;
+        unsigned int stack[MAX_DEPTH + 2];
+        unsigned int size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            const Node& node = nodes[stack[--size]];
+            int side = classify(frustum, node.bounds);
+            if (side == OUTSIDE)
+                continue;
+            // a subtree completely inside needs no more tests, its instances are one run of order
+            if (side == INSIDE)
+            {
+                result.insert(result.end(), order.begin() + node.first, order.begin() + node.first + node.count);
+                continue;
+            }
+            if (node.left != 0)
+            {
+                stack[size++] = node.left;
+                stack[size++] = node.left + 1;
+                continue;
+            }
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+                if (frustum.Intersects(worldBounds[order[i]]))
+                    result.push_back(order[i]);
+        }
+    }
+
+    // the closest instance box hit by the ray within maxDistance, false on a miss
+    // ------------------------------------------------------------------------
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, unsigned int& hit, float& distance, float maxDistance = FLT_MAX) const
+    {
+        if (nodes.empty())
+            return false;
+        glm::vec3 inverse = 1.0f / direction;
+        float best = maxDistance;
+        bool found = false;
+        unsigned int stack[MAX_DEPTH + 2];
+        unsigned int size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            const Node& node = nodes[stack[--size]];
+            if (rayBox(origin, inverse, node.bounds) >= best)
+                continue;
+            if (node.left != 0)
+            {
+                // the nearer child goes on top, so its hits shrink best before the other child is tested
+                float left = rayBox(origin, inverse, nodes[node.left].bounds);
+                float right = rayBox(origin, inverse, nodes[node.left + 1].bounds);
+                stack[size++] = left < right ? node.left + 1 : node.left;
+                stack[size++] = left < right ? node.left : node.left + 1;
+                continue;
+            }
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+            {
+                float t = rayBox(origin, inverse, worldBounds[order[i]]);
+                if (t < best)
+                {
+                    best = t;
+                    hit = order[i];
+                    found = true;
+                }
+            }
+        }
+        if (found)
+            distance = best;
+        return found;
+    }
+
+    // the instance whose box is closest to point within maxDistance, 0 distance when point is inside it
+    // ------------------------------------------------------------------------
+    bool Nearest(const glm::vec3& point, unsigned int& nearest, float& distance, float maxDistance = FLT_MAX) const
+    {
+        if (nodes.empty())
+            return false;
+        float best = maxDistance * maxDistance;
+        bool found = false;
+        unsigned int stack[MAX_DEPTH + 2];
+        unsigned int size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            const Node& node = nodes[stack[--size]];
+            if (distance2(point, node.bounds) >= best)
+                continue;
+            if (node.left != 0)
+            {
+                float left = distance2(point, nodes[node.left].bounds);
+                float right = distance2(point, nodes[node.left + 1].bounds);
+                stack[size++] = left < right ? node.left + 1 : node.left;
+                stack[size++] = left < right ? node.left : node.left + 1;
+                continue;
+            }
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+            {
+                float d = distance2(point, worldBounds[order[i]]);
+                if (d < best)
+                {
+                    best = d;
+                    nearest = order[i];
+                    found = true;
+                }
+            }
+        }
+        if (found)
+            distance = std::sqrt(best);
+        return found;
+    }
+
+private:
+    struct Instance
+    {
+        AABB localBounds;
+        glm::mat4 transform;
+    };
+
+    // every node covers the run [first, first + count) of order. interior nodes have their children at left and
+    // left + 1, leaves have left 0 (the root is never anyone's child)
+    struct Node
+    {
+        AABB bounds;
+        unsigned int left = 0;
+        unsigned int first = 0;
+        unsigned int count = 0;
+    };
+
+    enum { OUTSIDE, INTERSECTING, INSIDE };
+
+    std::vector<Instance> instances;
+    std::vector<AABB> worldBounds;
+    std::vector<Node> nodes;
+    std::vector<unsigned int> order;
+    // only needed while building
+    std::vector<glm::vec3> centroids;
+
+    static float area(const AABB& box)
+    {
+        if (box.Empty())
+            return 0.0f;
+        glm::vec3 size = box.Max - box.Min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    void build(unsigned int index, unsigned int first, unsigned int count, unsigned int depth)
+    {
+        AABB bounds, centroidBounds;
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            bounds.Extend(worldBounds[order[i]]);
+            centroidBounds.Extend(centroids[order[i]]);
+        }
+        nodes[index].bounds = bounds;
+        nodes[index].first = first;
+        nodes[index].count = count;
+        if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+            return;
+
+        // bin the centroids along every axis and take the cheapest split. a split costs one traversal step plus the
+        // instances on each side weighted by the chance a ray through the parent also enters that side
+        struct Bin
+        {
+            AABB bounds;
+            unsigned int count = 0;
+        };
+        int bestAxis = -1;
+        unsigned int bestSplit = 0;
+        float bestCost = (float)count;
+        glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+        float parentArea = area(bounds);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.0f)
+                continue;
+            Bin bins[BINS];
+            float scale = BINS / extent[axis];
+            for (unsigned int i = first; i < first + count; i++)
+            {
+                unsigned int bin = std::min((unsigned int)((centroids[order[i]][axis] - centroidBounds.Min[axis]) * scale), BINS - 1);
+                bins[bin].bounds.Extend(worldBounds[order[i]]);
+                bins[bin].count++;
+            }
+            // sweep from the right to have the cost of every right side ready, then from the left
+            float rightArea[BINS];
+            unsigned int rightCount[BINS];
+            AABB sweep;
+            unsigned int sweepCount = 0;
+            for (unsigned int b = BINS - 1; b > 0; b--)
+            {
+                sweep.Extend(bins[b].bounds);
+                sweepCount += bins[b].count;
+                rightArea[b] = area(sweep);
+                rightCount[b] = sweepCount;
+            }
+            sweep = AABB();
+            sweepCount = 0;
+            for (unsigned int b = 1; b < BINS; b++)
+            {
+                sweep.Extend(bins[b - 1].bounds);
+                sweepCount += bins[b - 1].count;
+                if (sweepCount == 0 || rightCount[b] == 0)
+                    continue;
+                float cost = 1.0f + (area(sweep) * sweepCount + rightArea[b] * rightCount[b]) / parentArea;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+        // no split pays off, or every centroid is in the same spot
+        if (bestAxis < 0)
+            return;
+
+        float low = centroidBounds.Min[bestAxis];
+        float scale = BINS / extent[bestAxis];
+        unsigned int* middle = std::partition(&order[first], &order[first] + count, [&](unsigned int id)
+        {
+            return std::min((unsigned int)((centroids[id][bestAxis] - low) * scale), BINS - 1) < bestSplit;
+        });
+        unsigned int leftCount = (unsigned int)(middle - &order[first]);
+
+        unsigned int left = (unsigned int)nodes.size();
+        nodes[index].left = left;
+        nodes.push_back(Node());
+        nodes.push_back(Node());
+        build(left, first, leftCount, depth + 1);
+        build(left + 1, first + leftCount, count - leftCount, depth + 1);
+    }
+
+    static int classify(const Frustum& frustum, const AABB& box)
+    {
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        int side = INSIDE;
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 normal = glm::vec3(frustum.Planes[i]);
+            float distance = glm::dot(normal, center) + frustum.Planes[i].w;
+            float radius = glm::dot(glm::abs(normal), extents);
+            if (distance + radius < 0.0f)
+                return OUTSIDE;
+            if (distance - radius < 0.0f)
+                side = INTERSECTING;
+        }
+        return side;
+    }
+
+    // entry distance of a ray into a box (0 when it starts inside), FLT_MAX on a miss
+    static float rayBox(const glm::vec3& origin, const glm::vec3& inverse, const AABB& box)
+    {
+        glm::vec3 t0 = (box.Min - origin) * inverse;
+        glm::vec3 t1 = (box.Max - origin) * inverse;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+        return enter <= exit ? enter : FLT_MAX;
+    }
+
+    static float distance2(const glm::vec3& point, const AABB& box)
+    {
+        glm::vec3 d = glm::max(glm::max(box.Min - point, point - box.Max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+};
+#endif
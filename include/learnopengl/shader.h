@@ -4,18 +4,26 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_reflection.h>
+
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // every uniform and block of the linked program
+    ProgramReflection Reflection;
+    // constructor generates the shader on the fly, or loads the program binary a previous run cached next to the
+    // fragment shader. defines ("NAME" or "NAME VALUE") are put in front of every stage, see ShaderPermutations
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::vector<std::string>& defines = std::vector<std::string>())
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -57,6 +65,19 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        injectDefines(vertexCode, defines);
+        injectDefines(fragmentCode, defines);
+        if (geometryPath != nullptr)
+            injectDefines(geometryCode, defines);
+
+        ID = glCreateProgram();
+        ProgramCache cache(ProgramCache::PathFor(fragmentPath, defines), { vertexCode, fragmentCode, geometryCode });
+        if (cache.Load(ID))
+        {
+            Reflection.Reflect(ID);
+            return;
+        }
+
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -82,13 +103,15 @@ public:
             checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        cache.Save(ID);
+        Reflection.Reflect(ID);
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -96,13 +119,33 @@ public:
             glDeleteShader(geometry);
 
     }
+    // the program is deleted with the shader, so a shader can be moved but not copied
+    // ------------------------------------------------------------------------
+    ~Shader()
+    {
+        if (ID)
+            glDeleteProgram(ID);
+    }
+    Shader(Shader&& other) noexcept : ID(other.ID), Reflection(std::move(other.Reflection))
+    {
+        other.ID = 0;
+    }
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
         glUseProgram(ID); 
     }
-    // utility uniform functions
+    // typed handle of a uniform, look it up once at setup and set it through the handle in the render loop
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> Uniform(const char* name) const
+    {
+        return Reflection.Handle<T>(name);
+    }
+    // utility uniform functions, they look the name up in Reflection on every call
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
@@ -165,18 +208,29 @@ private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
 
-    //creat a hasemap to store everything in the shader
-    //a dirty and quick hack
-    mutable std::unordered_map <std::string, GLint> m_UniformLocationCache;
-
     GLint GetUniformLocation(const std::string& name) const
     {
-        auto locationSearch = m_UniformLocationCache.find(name);
-        if (locationSearch != m_UniformLocationCache.end())
-            return locationSearch->second; // locationSearch->first is the key (name) and locationSearch->second is the value
-        GLint location = glGetUniformLocation(ID, name.c_str());
-        m_UniformLocationCache[name] = location;
-        return location;
+        return Reflection.Location(name.c_str());
+    }
+
+    // the defines go right after #version, which has to stay the first line. #line keeps the line numbers of compile
+    // errors pointing at the file
+    static void injectDefines(std::string& code, const std::vector<std::string>& defines)
+    {
+        if (defines.empty())
+            return;
+        std::string block;
+        for (unsigned int i = 0; i < defines.size(); i++)
+            block += "#define " + defines[i] + "\n";
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos)
+        {
+            code = block + "#line 1\n" + code;
+            return;
+        }
+        unsigned int nextLine = 2 + (unsigned int)std::count(code.begin(), code.begin() + lineEnd, '\n');
+        code.insert(lineEnd + 1, block + "#line " + std::to_string(nextLine) + "\n");
     }
 
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,67 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Specialized programs of one vertex / fragment pair. Every permutation is the pair compiled with a different set of
+// feature defines, so a shader can #ifdef out what a material does not use instead of branching on uniforms.
+// Permutations are compiled (or loaded from the program cache) the first time they are asked for and live as long as
+// this object. Get() returns a small index that stays valid, which is what draws are grouped by.
+class ShaderPermutations
+{
+public:
+    // constructor, sharedDefines go into every permutation
+    // ------------------------------------------------------------------------
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& sharedDefines = std::vector<std::string>())
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), sharedDefines(sharedDefines)
+    {
+    }
+
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // index of the permutation with defines, compiles it on first use. the order of defines does not matter
+    // ------------------------------------------------------------------------
+    unsigned int Get(std::vector<std::string> defines)
+    {
+        defines.insert(defines.end(), sharedDefines.begin(), sharedDefines.end());
+        std::sort(defines.begin(), defines.end());
+        defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+        for (unsigned int i = 0; i < keys.size(); i++)
+            if (keys[i] == defines)
+                return i;
+
+        shaders.emplace_back(new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, defines));
+        keys.push_back(defines);
+        if (setup)
+            setup(*shaders.back());
+        return (unsigned int)shaders.size() - 1;
+    }
+
+    // runs setup on every permutation compiled so far and on every later one, for uniforms that never change
+    // ------------------------------------------------------------------------
+    void SetSetup(std::function<void(Shader&)> setup)
+    {
+        this->setup = setup;
+        for (unsigned int i = 0; i < shaders.size(); i++)
+            setup(*shaders[i]);
+    }
+
+    Shader& operator[](unsigned int index) { return *shaders[index]; }
+    unsigned int Count() const { return (unsigned int)shaders.size(); }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> sharedDefines;
+    std::vector<std::unique_ptr<Shader>> shaders;
+    std::vector<std::vector<std::string>> keys;
+    std::function<void(Shader&)> setup;
+};
+#endif
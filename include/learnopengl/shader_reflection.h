@@ -0,0 +1,234 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// the GL types a uniform of type T may have, ints also set bools, samplers and images
+template <typename T> struct UniformType;
+template <> struct UniformType<float> { static bool Matches(GLenum type) { return type == GL_FLOAT; } };
+template <> struct UniformType<glm::vec2> { static bool Matches(GLenum type) { return type == GL_FLOAT_VEC2; } };
+template <> struct UniformType<glm::vec3> { static bool Matches(GLenum type) { return type == GL_FLOAT_VEC3; } };
+template <> struct UniformType<glm::vec4> { static bool Matches(GLenum type) { return type == GL_FLOAT_VEC4; } };
+template <> struct UniformType<glm::mat3> { static bool Matches(GLenum type) { return type == GL_FLOAT_MAT3; } };
+template <> struct UniformType<glm::mat4> { static bool Matches(GLenum type) { return type == GL_FLOAT_MAT4; } };
+
+// samplers and images are set through glUniform1i with their texture or image unit
+inline bool isSamplerOrImage(GLenum type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+    case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+    case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_SHADOW: case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+    case GL_IMAGE_1D: case GL_IMAGE_2D: case GL_IMAGE_3D: case GL_IMAGE_2D_RECT: case GL_IMAGE_CUBE:
+    case GL_IMAGE_BUFFER: case GL_IMAGE_1D_ARRAY: case GL_IMAGE_2D_ARRAY: case GL_IMAGE_CUBE_MAP_ARRAY:
+    case GL_IMAGE_2D_MULTISAMPLE: case GL_IMAGE_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_IMAGE_1D: case GL_INT_IMAGE_2D: case GL_INT_IMAGE_3D: case GL_INT_IMAGE_2D_RECT:
+    case GL_INT_IMAGE_CUBE: case GL_INT_IMAGE_BUFFER: case GL_INT_IMAGE_1D_ARRAY: case GL_INT_IMAGE_2D_ARRAY:
+    case GL_INT_IMAGE_CUBE_MAP_ARRAY: case GL_INT_IMAGE_2D_MULTISAMPLE: case GL_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_IMAGE_1D: case GL_UNSIGNED_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_3D:
+    case GL_UNSIGNED_INT_IMAGE_2D_RECT: case GL_UNSIGNED_INT_IMAGE_CUBE: case GL_UNSIGNED_INT_IMAGE_BUFFER:
+    case GL_UNSIGNED_INT_IMAGE_1D_ARRAY: case GL_UNSIGNED_INT_IMAGE_2D_ARRAY:
+    case GL_UNSIGNED_INT_IMAGE_CUBE_MAP_ARRAY: case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE:
+    case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <> struct UniformType<int>
+{
+    static bool Matches(GLenum type) { return type == GL_INT || type == GL_BOOL || isSamplerOrImage(type); }
+};
+
+inline void setUniform(GLint location, float value) { glUniform1f(location, value); }
+inline void setUniform(GLint location, int value) { glUniform1i(location, value); }
+inline void setUniform(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+inline void setUniform(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+// A uniform of one program, resolved by name once at setup. Setting it is a single glUniform call on its location,
+// the program has to be in use like with the string setters. A uniform the program does not have (or that the compiler
+// removed) gives an invalid handle, setting it does nothing.
+template <typename T>
+class UniformHandle
+{
+public:
+    UniformHandle() : location(-1) {}
+    explicit UniformHandle(GLint location) : location(location) {}
+
+    bool Valid() const { return location >= 0; }
+    GLint Location() const { return location; }
+
+    void Set(const T& value) const
+    {
+        if (location >= 0)
+            setUniform(location, value);
+    }
+
+private:
+    GLint location;
+};
+
+// Every active uniform and uniform / storage block of a linked program, read once through the program interface
+// query API. Both tables are sorted by name, so finding an entry is a binary search and never touches the driver.
+class ProgramReflection
+{
+public:
+    struct Uniform
+    {
+        std::string Name;
+        GLint Location;
+        GLenum Type;
+        GLint ArraySize;
+    };
+
+    struct Block
+    {
+        std::string Name;
+        // GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK
+        GLenum Interface;
+        GLint Binding;
+        GLint DataSize;
+    };
+
+    std::vector<Uniform> Uniforms;
+    std::vector<Block> Blocks;
+
+    // reads the tables of program, call after it linked (or its binary loaded)
+    // ------------------------------------------------------------------------
+    void Reflect(GLuint program)
+    {
+        Uniforms.clear();
+        Blocks.clear();
+        std::vector<char> name;
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+        const GLenum uniformProperties[4] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint values[4];
+            glGetProgramResourceiv(program, GL_UNIFORM, i, 4, uniformProperties, 4, NULL, values);
+            // block members are set through their buffer, they have no location
+            if (values[3] != -1 || values[0] < 0)
+                continue;
+            glGetProgramResourceName(program, GL_UNIFORM, i, (GLsizei)name.size(), NULL, name.data());
+            Uniform uniform = { baseName(name.data()), values[0], (GLenum)values[1], values[2] };
+            Uniforms.push_back(uniform);
+        }
+
+        const GLenum interfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+        const GLenum blockProperties[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        for (int j = 0; j < 2; j++)
+        {
+            glGetProgramInterfaceiv(program, interfaces[j], GL_ACTIVE_RESOURCES, &count);
+            glGetProgramInterfaceiv(program, interfaces[j], GL_MAX_NAME_LENGTH, &maxLength);
+            name.resize(std::max(maxLength, 1));
+            for (GLint i = 0; i < count; i++)
+            {
+                GLint values[2];
+                glGetProgramResourceiv(program, interfaces[j], i, 2, blockProperties, 2, NULL, values);
+                glGetProgramResourceName(program, interfaces[j], i, (GLsizei)name.size(), NULL, name.data());
+                Block block = { baseName(name.data()), interfaces[j], values[0], values[1] };
+                Blocks.push_back(block);
+            }
+        }
+
+        std::sort(Uniforms.begin(), Uniforms.end(), [](const Uniform& a, const Uniform& b) { return a.Name < b.Name; });
+        std::sort(Blocks.begin(), Blocks.end(), [](const Block& a, const Block& b) { return a.Name < b.Name; });
+    }
+
+    // index into Uniforms, -1 when the program has no such uniform
+    // ------------------------------------------------------------------------
+    int FindUniform(const char* name) const
+    {
+        return find(Uniforms, name);
+    }
+
+    // index into Blocks, -1 when the program has no such block
+    // ------------------------------------------------------------------------
+    int FindBlock(const char* name) const
+    {
+        return find(Blocks, name);
+    }
+
+    // location of a uniform, "name[i]" finds element i of an array
+    // ------------------------------------------------------------------------
+    GLint Location(const char* name) const
+    {
+        int index = FindUniform(name);
+        if (index >= 0)
+            return Uniforms[index].Location;
+        const char* bracket = std::strchr(name, '[');
+        if (bracket == NULL)
+            return -1;
+        index = FindUniform(std::string(name, bracket - name).c_str());
+        int element = std::atoi(bracket + 1);
+        if (index < 0 || element >= Uniforms[index].ArraySize)
+            return -1;
+        return Uniforms[index].Location + element;
+    }
+
+    // a typed handle, the reflected type has to fit T
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> Handle(const char* name) const
+    {
+        int index = FindUniform(name);
+        if (index < 0)
+            return UniformHandle<T>();
+        if (!UniformType<T>::Matches(Uniforms[index].Type))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << std::endl;
+            return UniformHandle<T>();
+        }
+        return UniformHandle<T>(Uniforms[index].Location);
+    }
+
+private:
+    // arrays are reported as "name[0]", they are looked up by their plain name
+    static std::string baseName(const char* name)
+    {
+        size_t length = std::strlen(name);
+        if (length > 3 && std::strcmp(name + length - 3, "[0]") == 0)
+            length -= 3;
+        return std::string(name, length);
+    }
+
+    template <typename Entry>
+    static int find(const std::vector<Entry>& entries, const char* name)
+    {
+        typename std::vector<Entry>::const_iterator found = std::lower_bound(entries.begin(), entries.end(), name,
+            [](const Entry& entry, const char* key) { return std::strcmp(entry.Name.c_str(), key) < 0; });
+        if (found == entries.end() || found->Name != name)
+            return -1;
+        return (int)(found - entries.begin());
+    }
+};
+#endif
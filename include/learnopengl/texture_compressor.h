@@ -0,0 +1,437 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/ktx_texture.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Offline block compression of material maps for the asset pipeline: albedo to BC7, normal maps to BC5 (x and y only,
+// pbr.fs rebuilds z) and the single channel maps to BC4. The whole mip chain is built here, albedo is filtered in
+// linear space and normals are renormalized per level, so the renderer never calls glGenerateMipmap for them.
+// BC7 only uses mode 6 (one subset, RGBA endpoints with p-bits, 4 bit indices): fast and plenty for these maps.
+// PackORM merges the ao, roughness and metallic maps of a material into one linear RGB map, also stored as BC7.
+class TextureCompressor
+{
+public:
+    enum Kind { ALBEDO, NORMAL, MASK, ORM };
+
+    // guesses the kind of map from its file name
+    // ------------------------------------------------------------------------
+    static Kind KindFromPath(const std::string& path)
+    {
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name.find("normal") != std::string::npos)
+            return NORMAL;
+        if (name.find("albedo") != std::string::npos || name.find("basecolor") != std::string::npos || name.find("diffuse") != std::string::npos)
+            return ALBEDO;
+        return MASK;
+    }
+
+    static GLenum InternalFormat(Kind kind)
+    {
+        if (kind == ALBEDO || kind == ORM)
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        return kind == NORMAL ? GL_COMPRESSED_RG_RGTC2 : GL_COMPRESSED_RED_RGTC1;
+    }
+
+    // decodes path, builds the mip chain and compresses every level. block rows are spread over the pool
+    // ------------------------------------------------------------------------
+    static bool Compress(const std::string& path, Kind kind, ThreadPool& pool, KtxTexture& out)
+    {
+        int width, height, fileComponents;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &fileComponents, Components(kind));
+        if (!data)
+        {
+            std::cout << "ERROR::TEXTURE_COMPRESSOR::CANNOT_LOAD " << path << std::endl;
+            return false;
+        }
+        CompressPixels(data, width, height, kind, pool, out);
+        stbi_image_free(data);
+        return true;
+    }
+
+    // channels CompressPixels expects for a kind
+    static int Components(Kind kind)
+    {
+        return kind == ALBEDO ? 4 : kind == MASK ? 1 : 3;
+    }
+
+    // same as Compress for an image already in memory, pixels has Components(kind) bytes per texel
+    // ------------------------------------------------------------------------
+    static void CompressPixels(const unsigned char* pixels, int width, int height, Kind kind, ThreadPool& pool, KtxTexture& out)
+    {
+        int components = Components(kind);
+        Image level;
+        level.width = width;
+        level.height = height;
+        level.components = components;
+        level.texels.resize((size_t)width * height * components);
+        for (size_t i = 0; i < level.texels.size(); i++)
+            level.texels[i] = toLinear(kind, (int)(i % components), pixels[i]);
+
+        out.InternalFormat = InternalFormat(kind);
+        out.Width = width;
+        out.Height = height;
+        out.Levels.clear();
+        for (;;)
+        {
+            out.Levels.push_back(encodeLevel(level, kind, pool));
+            if (level.width == 1 && level.height == 1)
+                break;
+            level = downsample(level, kind);
+        }
+    }
+
+    // packs ao into r, roughness into g and metallic into b at the size of the largest input, smaller maps are
+    // bilinearly resampled. a missing map is filled with the same flat value the renderer uses as placeholder.
+    // ------------------------------------------------------------------------
+    static bool PackORM(const std::string& aoPath, const std::string& roughnessPath, const std::string& metallicPath, ThreadPool& pool, KtxTexture& out)
+    {
+        const std::string paths[3] = { aoPath, roughnessPath, metallicPath };
+        const unsigned char defaults[3] = { 255, 128, 0 };
+        unsigned char* maps[3];
+        int widths[3], heights[3];
+        int width = 0, height = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            int fileComponents;
+            maps[i] = paths[i].empty() ? NULL : stbi_load(paths[i].c_str(), &widths[i], &heights[i], &fileComponents, 1);
+            if (maps[i])
+            {
+                width = std::max(width, widths[i]);
+                height = std::max(height, heights[i]);
+            }
+            else
+            {
+                std::cout << "ERROR::TEXTURE_COMPRESSOR::CANNOT_LOAD " << paths[i] << ", using a flat value" << std::endl;
+            }
+        }
+        if (width == 0)
+            return false;
+
+        std::vector<unsigned char> packed((size_t)width * height * 3);
+        for (int i = 0; i < 3; i++)
+        {
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    unsigned char value = defaults[i];
+                    if (maps[i])
+                        value = sampleBilinear(maps[i], widths[i], heights[i], (x + 0.5f) / width, (y + 0.5f) / height);
+                    packed[((size_t)y * width + x) * 3 + i] = value;
+                }
+            }
+            stbi_image_free(maps[i]);
+        }
+        CompressPixels(packed.data(), width, height, ORM, pool, out);
+        return true;
+    }
+
+private:
+    // a mip level in filtering space: linear color for albedo, [-1, 1] vectors for normals, [0, 1] for masks
+    struct Image
+    {
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        std::vector<float> texels;
+    };
+
+    static float toLinear(Kind kind, int channel, unsigned char value)
+    {
+        float v = value / 255.0f;
+        if (kind == ALBEDO && channel < 3)
+            return std::pow(v, 2.2f);
+        if (kind == NORMAL)
+            return v * 2.0f - 1.0f;
+        return v;
+    }
+
+    static unsigned char toStored(Kind kind, int channel, float value)
+    {
+        if (kind == ALBEDO && channel < 3)
+            value = std::pow(std::max(value, 0.0f), 1.0f / 2.2f);
+        else if (kind == NORMAL)
+            value = value * 0.5f + 0.5f;
+        return (unsigned char)std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f);
+    }
+
+    static unsigned char sampleBilinear(const unsigned char* map, int width, int height, float u, float v)
+    {
+        float x = std::min(std::max(u * width - 0.5f, 0.0f), (float)(width - 1));
+        float y = std::min(std::max(v * height - 0.5f, 0.0f), (float)(height - 1));
+        int x0 = (int)x, y0 = (int)y;
+        int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+        float fx = x - x0, fy = y - y0;
+        float top = map[y0 * width + x0] * (1.0f - fx) + map[y0 * width + x1] * fx;
+        float bottom = map[y1 * width + x0] * (1.0f - fx) + map[y1 * width + x1] * fx;
+        return (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+    }
+
+    static Image downsample(const Image& source, Kind kind)
+    {
+        Image target;
+        target.width = std::max(1, source.width / 2);
+        target.height = std::max(1, source.height / 2);
+        target.components = source.components;
+        target.texels.resize((size_t)target.width * target.height * target.components);
+        for (int y = 0; y < target.height; y++)
+        {
+            for (int x = 0; x < target.width; x++)
+            {
+                float* texel = &target.texels[((size_t)y * target.width + x) * target.components];
+                for (int dy = 0; dy < 2; dy++)
+                {
+                    for (int dx = 0; dx < 2; dx++)
+                    {
+                        int sx = std::min(x * 2 + dx, source.width - 1);
+                        int sy = std::min(y * 2 + dy, source.height - 1);
+                        const float* s = &source.texels[((size_t)sy * source.width + sx) * source.components];
+                        for (int c = 0; c < source.components; c++)
+                            texel[c] += s[c] * 0.25f;
+                    }
+                }
+                if (kind == NORMAL)
+                {
+                    float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+                    if (length > 0.0f)
+                        for (int c = 0; c < 3; c++)
+                            texel[c] /= length;
+                }
+            }
+        }
+        return target;
+    }
+
+    static std::vector<unsigned char> encodeLevel(const Image& level, Kind kind, ThreadPool& pool)
+    {
+        unsigned int blockBytes = KtxTexture::BlockBytes(InternalFormat(kind));
+        int blocksX = (level.width + 3) / 4;
+        int blocksY = (level.height + 3) / 4;
+        std::vector<unsigned char> blocks((size_t)blocksX * blocksY * blockBytes);
+        pool.ParallelFor(blocksY, [&](unsigned int by)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                // gather the 4x4 block as RGBA, clamping at the right and bottom edges
+                unsigned char rgba[16 * 4];
+                for (int i = 0; i < 16; i++)
+                {
+                    int x = std::min(bx * 4 + (i & 3), level.width - 1);
+                    int y = std::min((int)by * 4 + (i >> 2), level.height - 1);
+                    const float* s = &level.texels[((size_t)y * level.width + x) * level.components];
+                    for (int c = 0; c < 4; c++)
+                        rgba[i * 4 + c] = c < level.components ? toStored(kind, c, s[c]) : 255;
+                }
+                unsigned char* block = &blocks[((size_t)by * blocksX + bx) * blockBytes];
+                if (kind == ALBEDO || kind == ORM)
+                {
+                    encodeBC7(rgba, block);
+                }
+                else if (kind == NORMAL)
+                {
+                    encodeBC4(rgba + 0, block);
+                    encodeBC4(rgba + 1, block + 8);
+                }
+                else
+                {
+                    encodeBC4(rgba, block);
+                }
+            }
+        });
+        return blocks;
+    }
+
+    // BC4: two 8 bit endpoints and 3 bit indices. values is strided by 4 (one channel of the RGBA block)
+    static void encodeBC4(const unsigned char* values, unsigned char* out)
+    {
+        unsigned char lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min(lo, values[i * 4]);
+            hi = std::max(hi, values[i * 4]);
+        }
+        // red0 > red1 selects the 8 value palette: red0, red1 and six steps in between
+        out[0] = hi;
+        out[1] = lo;
+        uint64_t bits = 0;
+        if (hi > lo)
+        {
+            float palette[8];
+            palette[0] = hi;
+            palette[1] = lo;
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * hi + i * lo) / 7.0f;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                float bestError = 1e9f;
+                for (int p = 0; p < 8; p++)
+                {
+                    float error = std::fabs(values[i * 4] - palette[p]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                bits |= (uint64_t)best << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (unsigned char)(bits >> (8 * i));
+    }
+
+    // BC7 mode 6: endpoints along the principal axis of the block, every p-bit combination is tried
+    static void encodeBC7(const unsigned char* rgba, unsigned char* out)
+    {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                mean[c] += rgba[i * 4 + c] / 16.0f;
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int a = 0; a < 4; a++)
+                for (int b = 0; b < 4; b++)
+                    next[a] += covariance[a][b] * axis[b];
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < 4; c++)
+                axis[c] = next[c] / length;
+        }
+        float tMin = 1e9f, tMax = -1e9f;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++)
+                t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+        float endpoints[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = std::min(std::max(mean[c] + tMin * axis[c], 0.0f), 255.0f);
+            endpoints[1][c] = std::min(std::max(mean[c] + tMax * axis[c], 0.0f), 255.0f);
+        }
+
+        int bestQuantized[2][4] = {};
+        int bestPBits[2] = { 0, 0 };
+        int bestIndices[16] = {};
+        int bestError = 0x7fffffff;
+        for (int pBits = 0; pBits < 4; pBits++)
+        {
+            int p[2] = { pBits & 1, pBits >> 1 };
+            int quantized[2][4];
+            int palette[16][4];
+            int expanded[2][4];
+            for (int e = 0; e < 2; e++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    quantized[e][c] = std::min(std::max((int)((endpoints[e][c] - p[e]) / 2.0f + 0.5f), 0), 127);
+                    expanded[e][c] = (quantized[e][c] << 1) | p[e];
+                }
+            }
+            for (int i = 0; i < 16; i++)
+                for (int c = 0; c < 4; c++)
+                    palette[i][c] = ((64 - weights[i]) * expanded[0][c] + weights[i] * expanded[1][c] + 32) >> 6;
+
+            int indices[16];
+            int error = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestPixelError = 0x7fffffff;
+                for (int j = 0; j < 16; j++)
+                {
+                    int pixelError = 0;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int d = rgba[i * 4 + c] - palette[j][c];
+                        pixelError += d * d;
+                    }
+                    if (pixelError < bestPixelError)
+                    {
+                        bestPixelError = pixelError;
+                        best = j;
+                    }
+                }
+                indices[i] = best;
+                error += bestPixelError;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                std::copy(&quantized[0][0], &quantized[0][0] + 8, &bestQuantized[0][0]);
+                bestPBits[0] = p[0];
+                bestPBits[1] = p[1];
+                std::copy(indices, indices + 16, bestIndices);
+            }
+        }
+
+        // the msb of the first index is implicit 0, swap the endpoints if it would be set
+        if (bestIndices[0] & 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+            std::swap(bestPBits[0], bestPBits[1]);
+            for (int i = 0; i < 16; i++)
+                bestIndices[i] = 15 - bestIndices[i];
+        }
+
+        BitWriter writer(out);
+        writer.Put(1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            writer.Put(bestQuantized[0][c], 7);
+            writer.Put(bestQuantized[1][c], 7);
+        }
+        writer.Put(bestPBits[0], 1);
+        writer.Put(bestPBits[1], 1);
+        writer.Put(bestIndices[0], 3);
+        for (int i = 1; i < 16; i++)
+            writer.Put(bestIndices[i], 4);
+    }
+
+    // writes a 128 bit block lsb first
+    struct BitWriter
+    {
+        unsigned char* bytes;
+        int position;
+
+        explicit BitWriter(unsigned char* out) : bytes(out), position(0)
+        {
+            std::fill(bytes, bytes + 16, (unsigned char)0);
+        }
+
+        void Put(int value, int count)
+        {
+            for (int i = 0; i < count; i++, position++)
+                if (value & (1 << i))
+                    bytes[position >> 3] |= (unsigned char)(1 << (position & 7));
+        }
+    };
+};
+#endif
@@ -0,0 +1,339 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <learnopengl/ktx_texture.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Loads material maps without stalling the render thread. Load() queues the decode on a ThreadPool and returns an id
+// at once. Until the image is on the GPU, Handle(id) is the bindless handle of a 1x1 placeholder, so the first frames
+// render with flat colors while decoding continues. Update() runs on the GL context thread once per frame: it takes
+// the decoded images, copies them into a persistently mapped PBO ring and creates the textures in one batch,
+// bounded by a byte budget so a frame never uploads everything at once.
+// When the asset pipeline wrote a block compressed .ktx next to an image, that file is uploaded with its own mip chain
+// instead of decoding the image and generating mips at runtime. A .ktx can also be loaded directly by its own path.
+//
+// stbi_set_flip_vertically_on_load is a global in this stb_image version and the workers read it while decoding,
+// so nothing may flip it while loads are in flight. Use FlipRows on the decoded data instead.
+class TextureLoader
+{
+public:
+    // constructor, stagingSize is the PBO ring, uploadBudget the bytes copied per Update()
+    // ------------------------------------------------------------------------
+    TextureLoader(ThreadPool& pool, unsigned int stagingSize = 64 << 20, unsigned int uploadBudget = 32 << 20)
+        : pool(pool), stagingSize(stagingSize), uploadBudget(uploadBudget), stagingHead(0)
+    {
+        glGenBuffers(1, &stagingBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, stagingSize, NULL, flags);
+        stagingMemory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stagingSize, flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!stagingMemory)
+            std::cout << "ERROR::TEXTURE_LOADER::CANNOT_MAP_STAGING_BUFFER" << std::endl;
+    }
+
+    // makes every handle non-resident and deletes the textures, the placeholders and the staging ring with its fences.
+    // decodes still in flight are waited for and dropped. needs the GL context that created the loader to be current
+    // ------------------------------------------------------------------------
+    ~TextureLoader()
+    {
+        for (unsigned int i = 0; i < pending.size(); i++)
+            stbi_image_free(entries[pending[i]].decoded.get().data);
+        for (unsigned int i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].texture == 0)
+                continue;
+            glMakeTextureHandleNonResidentARB(entries[i].handle);
+            glDeleteTextures(1, &entries[i].texture);
+        }
+        for (std::map<unsigned int, GLuint64>::iterator it = placeholders.begin(); it != placeholders.end(); ++it)
+            glMakeTextureHandleNonResidentARB(it->second);
+        if (!placeholderTextures.empty())
+            glDeleteTextures((GLsizei)placeholderTextures.size(), placeholderTextures.data());
+        for (unsigned int i = 0; i < inFlight.size(); i++)
+            glDeleteSync(inFlight[i].fence);
+        // deleting the buffer unmaps it
+        glDeleteBuffers(1, &stagingBuffer);
+    }
+
+    // use the .ktx written by asset-pipeline compress when there is one
+    bool PreferCompressed = true;
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // queues path for decoding. placeholder is the color Handle() returns until the texture is ready
+    // ------------------------------------------------------------------------
+    unsigned int Load(const std::string& path, const glm::vec4& placeholder)
+    {
+        Entry entry;
+        entry.path = path;
+        entry.handle = placeholderHandle(placeholder);
+        bool preferCompressed = PreferCompressed;
+        entry.decoded = pool.Submit([path, preferCompressed]
+        {
+            DecodedImage image;
+            std::string compressedPath = KtxTexture::PathFor(path);
+            if ((preferCompressed || compressedPath == path) && image.compressed.Load(compressedPath))
+                return image;
+            image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+            return image;
+        });
+        entries.push_back(std::move(entry));
+        pending.push_back((unsigned int)entries.size() - 1);
+        return (unsigned int)entries.size() - 1;
+    }
+
+    // creates the textures whose decode has finished, up to the upload budget. returns how many became ready
+    // ------------------------------------------------------------------------
+    unsigned int Update()
+    {
+        return process(false);
+    }
+
+    // blocks until every queued texture is on the GPU
+    // ------------------------------------------------------------------------
+    void Finish()
+    {
+        process(true);
+    }
+
+    // bindless handle of the texture, or of its placeholder while it is still loading
+    GLuint64 Handle(unsigned int id) const { return entries[id].handle; }
+    // 0 while the texture is still loading or if it failed to load
+    unsigned int Texture(unsigned int id) const { return entries[id].texture; }
+    bool Ready(unsigned int id) const { return entries[id].texture != 0; }
+    unsigned int Pending() const { return (unsigned int)pending.size(); }
+
+    // flips an image in place, for loads that need row 0 at the bottom
+    // ------------------------------------------------------------------------
+    static void FlipRows(void* data, size_t rowBytes, int height)
+    {
+        unsigned char* bytes = (unsigned char*)data;
+        std::vector<unsigned char> row(rowBytes);
+        for (int y = 0; y < height / 2; y++)
+        {
+            unsigned char* top = bytes + y * rowBytes;
+            unsigned char* bottom = bytes + (height - 1 - y) * rowBytes;
+            std::memcpy(row.data(), top, rowBytes);
+            std::memcpy(top, bottom, rowBytes);
+            std::memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+
+private:
+    struct DecodedImage
+    {
+        unsigned char* data = nullptr;
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        KtxTexture compressed;
+    };
+
+    struct Entry
+    {
+        std::string path;
+        std::future<DecodedImage> decoded;
+        unsigned int texture = 0;
+        GLuint64 handle = 0;
+    };
+
+    // a range of the staging ring that the GPU may still be reading
+    struct StagingRange
+    {
+        size_t begin;
+        size_t end;
+        GLsync fence;
+    };
+
+    ThreadPool& pool;
+    std::vector<Entry> entries;
+    std::vector<unsigned int> pending;
+    std::map<unsigned int, GLuint64> placeholders;
+    std::vector<unsigned int> placeholderTextures;
+
+    unsigned int stagingBuffer;
+    unsigned char* stagingMemory;
+    size_t stagingSize;
+    size_t uploadBudget;
+    size_t stagingHead;
+    std::deque<StagingRange> inFlight;
+
+    unsigned int process(bool wait)
+    {
+        size_t uploaded = 0;
+        unsigned int finished = 0;
+        // entries that stay pending are compacted in place, so a frame with nothing to finish allocates nothing
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < pending.size(); i++)
+        {
+            Entry& entry = entries[pending[i]];
+            bool over = !wait && uploaded >= uploadBudget;
+            if (over || (!wait && entry.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+            {
+                pending[kept++] = pending[i];
+                continue;
+            }
+            DecodedImage image = entry.decoded.get();
+            if (!image.compressed.Levels.empty())
+            {
+                for (unsigned int mip = 0; mip < image.compressed.Levels.size(); mip++)
+                    uploaded += image.compressed.Levels[mip].size();
+                createCompressedTexture(entry, image.compressed);
+                finished++;
+            }
+            else if (image.data)
+            {
+                uploaded += (size_t)image.width * image.height * image.components;
+                createTexture(entry, image);
+                finished++;
+            }
+            else
+            {
+                std::cout << "Texture failed to load at path: " << entry.path << std::endl;
+            }
+            stbi_image_free(image.data);
+        }
+        pending.resize(kept);
+        return finished;
+    }
+
+    void createTexture(Entry& entry, const DecodedImage& image)
+    {
+        static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+        static const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+        GLenum format = formats[image.components - 1];
+        GLenum internalFormat = internalFormats[image.components - 1];
+        GLsizei levels = 1 + (GLsizei)std::floor(std::log2((float)std::max(image.width, image.height)));
+        size_t size = (size_t)image.width * image.height * image.components;
+
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        const void* pixels = beginUpload(image.data, size);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, pixels);
+        endUpload();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        finishTexture(entry);
+    }
+
+    void createCompressedTexture(Entry& entry, const KtxTexture& ktx)
+    {
+        glGenTextures(1, &entry.texture);
+        glBindTexture(GL_TEXTURE_2D, entry.texture);
+        glTexStorage2D(GL_TEXTURE_2D, (GLsizei)ktx.Levels.size(), ktx.InternalFormat, ktx.Width, ktx.Height);
+        for (unsigned int mip = 0; mip < ktx.Levels.size(); mip++)
+        {
+            const std::vector<unsigned char>& level = ktx.Levels[mip];
+            const void* blocks = beginUpload(level.data(), level.size());
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, mip, 0, 0, ktx.MipWidth(mip), ktx.MipHeight(mip), ktx.InternalFormat, (GLsizei)level.size(), blocks);
+            endUpload();
+        }
+        finishTexture(entry);
+    }
+
+    void finishTexture(Entry& entry)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        entry.handle = glGetTextureHandleARB(entry.texture);
+        glMakeTextureHandleResidentARB(entry.handle);
+    }
+
+    // copies data into the staging ring and binds it. returns what the following glTex*Image call takes as pixels:
+    // an offset into the PBO, or data itself when it is larger than the whole ring
+    const void* beginUpload(const void* data, size_t size)
+    {
+        size_t offset;
+        if (!reserveStaging(size, offset))
+            return data;
+        std::memcpy(stagingMemory + offset, data, size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        StagingRange range = { offset, offset + size, 0 };
+        inFlight.push_back(range);
+        return (const void*)offset;
+    }
+
+    // fences the range beginUpload handed out, once the upload reading it is queued
+    void endUpload()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!inFlight.empty() && inFlight.back().fence == 0)
+            inFlight.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // hands out ring space in order, waiting for the GPU to be done with the oldest uploads when it catches up to them
+    bool reserveStaging(size_t size, size_t& offset)
+    {
+        if (!stagingMemory || size > stagingSize)
+            return false;
+        if (stagingHead + size > stagingSize)
+        {
+            // wrap, whatever is left between the head and the end of the ring is older than the start
+            while (!inFlight.empty() && inFlight.front().begin >= stagingHead)
+                waitOldest();
+            stagingHead = 0;
+        }
+        while (!inFlight.empty() && inFlight.front().begin < stagingHead + size && inFlight.front().end > stagingHead)
+            waitOldest();
+        offset = stagingHead;
+        stagingHead += size;
+        return true;
+    }
+
+    void waitOldest()
+    {
+        GLsync fence = inFlight.front().fence;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fence);
+        inFlight.pop_front();
+    }
+
+    GLuint64 placeholderHandle(const glm::vec4& color)
+    {
+        unsigned char texel[4];
+        for (int i = 0; i < 4; i++)
+            texel[i] = (unsigned char)(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        unsigned int key;
+        std::memcpy(&key, texel, sizeof(key));
+        std::map<unsigned int, GLuint64>::iterator found = placeholders.find(key);
+        if (found != placeholders.end())
+            return found->second;
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        GLuint64 handle = glGetTextureHandleARB(texture);
+        glMakeTextureHandleResidentARB(handle);
+        placeholders[key] = handle;
+        placeholderTextures.push_back(texture);
+        return handle;
+    }
+};
+#endif
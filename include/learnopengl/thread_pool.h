@@ -0,0 +1,110 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A fixed set of worker threads pulling tasks from one queue. The workers have no GL context,
+// so tasks must stay on the CPU side.
+class ThreadPool
+{
+public:
+    // constructor, 0 threads means one per hardware thread
+    // ------------------------------------------------------------------------
+    explicit ThreadPool(unsigned int threadCount = 0) : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int Size() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    // queues a task and returns a future for its result
+    // ------------------------------------------------------------------------
+    template <typename F>
+    std::future<decltype(std::declval<F&>()())> Submit(F&& task)
+    {
+        typedef decltype(std::declval<F&>()()) Result;
+        std::shared_ptr<std::packaged_task<Result()>> packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.push([packaged] { (*packaged)(); });
+        }
+        queueCondition.notify_one();
+        return result;
+    }
+
+    // runs body(0) .. body(count - 1) across all workers and blocks until every index is done.
+    // indices are handed out one at a time, so uneven work items still balance.
+    // ------------------------------------------------------------------------
+    void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+    {
+        std::atomic<unsigned int> next(0);
+        std::vector<std::future<void>> pending;
+        unsigned int jobs = std::min(count, Size());
+        for (unsigned int i = 0; i < jobs; i++)
+        {
+            pending.push_back(Submit([&next, count, &body]
+            {
+                for (unsigned int index = next++; index < count; index = next++)
+                    body(index);
+            }));
+        }
+        for (unsigned int i = 0; i < pending.size(); i++)
+            pending[i].get();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+#endif
@@ -0,0 +1,1111 @@
+// Offline asset pipeline. Everything here is scene independent or only depends on files in resources/,
+// so it runs once at build time and the renderer just loads the results.
+//
+// usage: asset-pipeline <command> [options]
+
+// windows.h, through mapped_file.h, has to come before glad: both define APIENTRY
+#include <learnopengl/mapped_file.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/brdf_lut.h>
+#include <learnopengl/texture_compressor.h>
+#include <learnopengl/scene_bvh.h>
+#include <learnopengl/ibl_cache.h>
+#include <learnopengl/indirect_renderer.h>
+#include <learnopengl/frame_ring.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/meshlets.h>
+#include <learnopengl/model.h>
+#include <learnopengl/pbr_frame.h>
+
+#include <stb_image.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+int brdfLutCommand(int argc, char** argv);
+int compressCommand(int argc, char** argv);
+int packOrmCommand(int argc, char** argv);
+int benchBvhCommand(int argc, char** argv);
+int benchMeshCommand(int argc, char** argv);
+int checkMeshletsCommand(int argc, char** argv);
+int bakeIblCommand(int argc, char** argv);
+int frameAllocationsCommand(int argc, char** argv);
+void printUsage();
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+    std::string command = argv[1];
+    if (command == "brdf-lut")
+        return brdfLutCommand(argc - 2, argv + 2);
+    if (command == "compress")
+        return compressCommand(argc - 2, argv + 2);
+    if (command == "pack-orm")
+        return packOrmCommand(argc - 2, argv + 2);
+    if (command == "bench-bvh")
+        return benchBvhCommand(argc - 2, argv + 2);
+    if (command == "bench-mesh")
+        return benchMeshCommand(argc - 2, argv + 2);
+    if (command == "check-meshlets")
+        return checkMeshletsCommand(argc - 2, argv + 2);
+    if (command == "bake-ibl")
+        return bakeIblCommand(argc - 2, argv + 2);
+    if (command == "frame-allocations")
+        return frameAllocationsCommand(argc - 2, argv + 2);
+
+    std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_COMMAND " << command << std::endl;
+    printUsage();
+    return 1;
+}
+
+void printUsage()
+{
+    std::cout << "usage: asset-pipeline <command> [options]\n"
+              << "  brdf-lut [--out path] [--size n] [--samples n] [--no-multiscatter]\n"
+              << "      integrates the split sum BRDF LUT, default out resources/textures/brdf_lut.bin\n"
+              << "  compress [--kind albedo|normal|mask] image...\n"
+              << "      BC7 / BC5 / BC4 with a full mip chain, written as a .ktx next to each image.\n"
+              << "      the kind is guessed from the file name unless given\n"
+              << "  pack-orm <material dir> | --ao path --roughness path --metallic path --out path.ktx\n"
+              << "      packs ao / roughness / metallic into the r / g / b of one BC7 map, default out <dir>/orm.ktx\n"
+              << "  bench-bvh [--instances n]...\n"
+              << "      times SceneBVH build, refit and queries on random scenes, default 10k, 100k and 1M instances\n"
+              << "  bench-mesh [--grid n]\n"
+              << "      runs the vertex cache and overdraw passes of MeshOptimizer on a grid of n x n quads in shuffled\n"
+              << "      triangle order and prints the ACMR / ATVR after each, default n 400 (320k triangles)\n"
+              << "  check-meshlets [--trials n] [model...]\n"
+              << "      imports the models like the renderer and fails when the meshlet cone or frustum test rejects a meshlet\n"
+              << "      with a front facing triangle in view, over n random cameras and instance transforms per mesh.\n"
+              << "      default 1000 trials of the bundled models\n"
+              << "  bake-ibl [--hdr path] [--reference path] [--threads n] [--tolerance x]\n"
+              << "      bakes the environment, irradiance and prefilter maps with IBLCpuBaker and reports texels/s per core.\n"
+              << "      compares them with the GPU bake the renderer cached in <hdr>.iblcache and fails above a relative\n"
+              << "      rms error of x when a tolerance is given\n"
+              << "  frame-allocations [--warmup n] [--frames n] [--instances n]\n"
+              << "      runs the frame of the renderer (PbrFrame) over the bundled models in a hidden window and fails when a\n"
+              << "      frame after the warm-up and the texture loads allocates, default 120 warm-up and 600 counted frames of\n"
+              << "      64 instances" << std::endl;
+}
+
+// brdf lut
+// ------------------------------------------------------------------------
+int brdfLutCommand(int argc, char** argv)
+{
+    std::string outPath = FileSystem::getPath("resources/textures/brdf_lut.bin");
+    unsigned int size = BrdfLut::DEFAULT_SIZE;
+    unsigned int samples = BrdfLut::DEFAULT_SAMPLES;
+    bool multiscatter = true;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            samples = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-multiscatter") == 0)
+            multiscatter = false;
+        else
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (size == 0 || size > 4096 || samples == 0)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::BAD_BRDF_LUT_SIZE" << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BrdfLut lut = BrdfLut::Generate(pool, size, samples, multiscatter);
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    if (!lut.Save(outPath))
+        return 1;
+    std::cout << "BRDF LUT " << size << "x" << size << ", " << lut.Channels << " channels, " << samples << " samples in "
+              << seconds << "s on " << pool.Size() << " threads -> " << outPath << std::endl;
+    return 0;
+}
+
+// compress
+// ------------------------------------------------------------------------
+int compressCommand(int argc, char** argv)
+{
+    bool forceKind = false;
+    TextureCompressor::Kind kind = TextureCompressor::MASK;
+    std::vector<std::string> inputs;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--kind") == 0 && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            forceKind = true;
+            if (name == "albedo")
+                kind = TextureCompressor::ALBEDO;
+            else if (name == "normal")
+                kind = TextureCompressor::NORMAL;
+            else if (name == "mask")
+                kind = TextureCompressor::MASK;
+            else
+            {
+                std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_KIND " << name << std::endl;
+                return 1;
+            }
+        }
+        else
+            inputs.push_back(argv[i]);
+    }
+    if (inputs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    static const char* kindNames[] = { "BC7 albedo", "BC5 normal", "BC4 mask", "BC7 orm" };
+    ThreadPool pool;
+    int failures = 0;
+    for (unsigned int i = 0; i < inputs.size(); i++)
+    {
+        TextureCompressor::Kind inputKind = forceKind ? kind : TextureCompressor::KindFromPath(inputs[i]);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        KtxTexture ktx;
+        std::string outPath = KtxTexture::PathFor(inputs[i]);
+        if (!TextureCompressor::Compress(inputs[i], inputKind, pool, ktx) || !ktx.Save(outPath))
+        {
+            failures++;
+            continue;
+        }
+        float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        size_t bytes = 0;
+        for (unsigned int mip = 0; mip < ktx.Levels.size(); mip++)
+            bytes += ktx.Levels[mip].size();
+        std::cout << kindNames[inputKind] << " " << ktx.Width << "x" << ktx.Height << ", " << ktx.Levels.size() << " mips, "
+                  << bytes / 1024 << " KiB in " << seconds << "s -> " << outPath << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// pack orm
+// ------------------------------------------------------------------------
+std::string findImage(const std::string& directory, const std::string& name)
+{
+    static const char* extensions[] = { ".png", ".jpg" };
+    for (int i = 0; i < 2; i++)
+    {
+        std::string path = directory + "/" + name + extensions[i];
+        if (std::ifstream(path))
+            return path;
+    }
+    return "";
+}
+
+int packOrmCommand(int argc, char** argv)
+{
+    std::string aoPath, roughnessPath, metallicPath, outPath;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--ao") == 0 && i + 1 < argc)
+            aoPath = argv[++i];
+        else if (std::strcmp(argv[i], "--roughness") == 0 && i + 1 < argc)
+            roughnessPath = argv[++i];
+        else if (std::strcmp(argv[i], "--metallic") == 0 && i + 1 < argc)
+            metallicPath = argv[++i];
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else
+        {
+            // a material directory with ao, roughness and metallic images in it
+            std::string directory = argv[i];
+            aoPath = findImage(directory, "ao");
+            roughnessPath = findImage(directory, "roughness");
+            metallicPath = findImage(directory, "metallic");
+            if (outPath.empty())
+                outPath = directory + "/orm.ktx";
+        }
+    }
+    if (outPath.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    ThreadPool pool;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    KtxTexture ktx;
+    if (!TextureCompressor::PackORM(aoPath, roughnessPath, metallicPath, pool, ktx) || !ktx.Save(outPath))
+        return 1;
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "BC7 orm " << ktx.Width << "x" << ktx.Height << ", " << ktx.Levels.size() << " mips in " << seconds << "s -> " << outPath << std::endl;
+    return 0;
+}
+
+// bench bvh
+// ------------------------------------------------------------------------
+float secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the same box tests as SceneBVH, for checking its answers against every box
+float bruteRayBox(const glm::vec3& origin, const glm::vec3& direction, const AABB& box)
+{
+    glm::vec3 inverse = 1.0f / direction;
+    glm::vec3 t0 = (box.Min - origin) * inverse;
+    glm::vec3 t1 = (box.Max - origin) * inverse;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+float bruteDistance(const glm::vec3& point, const AABB& box)
+{
+    glm::vec3 d = glm::max(glm::max(box.Min - point, point - box.Max), glm::vec3(0.0f));
+    return std::sqrt(glm::dot(d, d));
+}
+
+// a query answer is right when it found something exactly when the brute force did, at the same distance, and the
+// returned box really is at that distance (boxes the point is inside all tie at 0)
+bool sameAnswer(bool found, float distance, float hitDistance, float expected)
+{
+    if (found != (expected < FLT_MAX))
+        return false;
+    if (!found)
+        return true;
+    float tolerance = 1e-5f * (1.0f + expected);
+    return std::abs(distance - expected) <= tolerance && std::abs(hitDistance - expected) <= tolerance;
+}
+
+// false when a query of the bvh disagreed with testing every box
+bool benchBvh(unsigned int instanceCount)
+{
+    // unit-ish boxes at a constant density, so the visible part of the scene grows with its size like a real level would
+    std::mt19937 random(1234);
+    float side = 4.0f * std::cbrt((float)instanceCount);
+    std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+    std::uniform_real_distribution<float> size(0.25f, 1.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    SceneBVH scene;
+    std::vector<glm::vec3> positions(instanceCount);
+    for (unsigned int i = 0; i < instanceCount; i++)
+    {
+        AABB box;
+        box.Extend(-glm::vec3(size(random), size(random), size(random)));
+        box.Extend(glm::vec3(size(random), size(random), size(random)));
+        positions[i] = glm::vec3(position(random), position(random), position(random));
+        scene.Add(box, glm::translate(glm::mat4(1.0f), positions[i]));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    scene.Build();
+    float buildSeconds = secondsSince(start);
+
+    // every instance moves a little, like the orbiting spheres do each frame
+    for (unsigned int i = 0; i < instanceCount; i++)
+        scene.SetTransform(i, glm::translate(glm::mat4(1.0f), positions[i] + 0.5f * glm::vec3(unit(random), unit(random), unit(random))));
+    start = std::chrono::steady_clock::now();
+    scene.Refit();
+    float refitSeconds = secondsSince(start);
+
+    // frustum queries from random cameras, checked against testing every box
+    const unsigned int frustumQueries = 64;
+    std::vector<unsigned int> result;
+    std::vector<unsigned char> visible;
+    FrustumCuller culler;
+    for (unsigned int i = 0; i < instanceCount; i++)
+        culler.Add(scene.Bounds(i));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, side * 0.25f);
+    std::vector<Frustum> frustums(frustumQueries);
+    for (unsigned int q = 0; q < frustumQueries; q++)
+    {
+        glm::vec3 eye(position(random), position(random), position(random));
+        glm::vec3 target(position(random), position(random), position(random));
+        frustums[q] = Frustum::FromMatrix(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int q = 0; q < frustumQueries; q++)
+    {
+        result.clear();
+        scene.QueryFrustum(frustums[q], result);
+        found += result.size();
+    }
+    float frustumSeconds = secondsSince(start);
+    size_t expected = 0;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int q = 0; q < frustumQueries; q++)
+        expected += culler.Cull(frustums[q], visible);
+    float linearSeconds = secondsSince(start);
+
+    // outside the timing, every query has to return exactly the ids the culler keeps
+    bool passed = true;
+    std::vector<unsigned int> culled;
+    for (unsigned int q = 0; q < frustumQueries; q++)
+    {
+        result.clear();
+        scene.QueryFrustum(frustums[q], result);
+        std::sort(result.begin(), result.end());
+        culler.Cull(frustums[q], visible);
+        culled.clear();
+        for (unsigned int i = 0; i < instanceCount; i++)
+            if (visible[i])
+                culled.push_back(i);
+        if (result != culled)
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::BVH_FRUSTUM_MISMATCH query " << q << ": " << result.size() << " ids, " << culled.size() << " expected" << std::endl;
+            passed = false;
+        }
+    }
+
+    // rays and nearest queries from random points, made up front so the timed answers can be checked afterwards
+    const unsigned int pointQueries = 100000;
+    std::vector<glm::vec3> origins(pointQueries), directions(pointQueries), points(pointQueries);
+    for (unsigned int q = 0; q < pointQueries; q++)
+    {
+        origins[q] = glm::vec3(position(random), position(random), position(random));
+        directions[q] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-4f));
+        points[q] = glm::vec3(position(random), position(random), position(random));
+    }
+    std::vector<unsigned char> rayFound(pointQueries), nearestFound(pointQueries);
+    std::vector<unsigned int> rayHit(pointQueries), nearestHit(pointQueries);
+    std::vector<float> rayDistance(pointQueries), nearestDistance(pointQueries);
+    unsigned int hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int q = 0; q < pointQueries; q++)
+    {
+        rayFound[q] = scene.Raycast(origins[q], directions[q], rayHit[q], rayDistance[q]) ? 1 : 0;
+        hits += rayFound[q];
+    }
+    float raySeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (unsigned int q = 0; q < pointQueries; q++)
+        nearestFound[q] = scene.Nearest(points[q], nearestHit[q], nearestDistance[q]) ? 1 : 0;
+    float nearestSeconds = secondsSince(start);
+
+    // testing every box is slow, a budget of box tests decides how many of the queries get checked
+    unsigned int checkedQueries = std::min(pointQueries, std::max(50000000u / instanceCount, 1u));
+    unsigned int rayErrors = 0, nearestErrors = 0;
+    for (unsigned int q = 0; q < checkedQueries; q++)
+    {
+        float rayExpected = FLT_MAX, nearestExpected = FLT_MAX;
+        for (unsigned int i = 0; i < instanceCount; i++)
+        {
+            rayExpected = std::min(rayExpected, bruteRayBox(origins[q], directions[q], scene.Bounds(i)));
+            nearestExpected = std::min(nearestExpected, bruteDistance(points[q], scene.Bounds(i)));
+        }
+        float rayHitDistance = rayFound[q] ? bruteRayBox(origins[q], directions[q], scene.Bounds(rayHit[q])) : FLT_MAX;
+        float nearestHitDistance = nearestFound[q] ? bruteDistance(points[q], scene.Bounds(nearestHit[q])) : FLT_MAX;
+        if (!sameAnswer(rayFound[q] != 0, rayDistance[q], rayHitDistance, rayExpected))
+            rayErrors++;
+        if (!sameAnswer(nearestFound[q] != 0, nearestDistance[q], nearestHitDistance, nearestExpected))
+            nearestErrors++;
+    }
+    if (rayErrors > 0)
+        std::cout << "ERROR::ASSET_PIPELINE::BVH_RAYCAST_MISMATCH " << rayErrors << " of " << checkedQueries << " rays" << std::endl;
+    if (nearestErrors > 0)
+        std::cout << "ERROR::ASSET_PIPELINE::BVH_NEAREST_MISMATCH " << nearestErrors << " of " << checkedQueries << " queries" << std::endl;
+    passed = passed && rayErrors == 0 && nearestErrors == 0;
+
+    std::cout << instanceCount << " instances\n"
+              << "  build " << buildSeconds * 1000.0f << " ms, refit " << refitSeconds * 1000.0f << " ms\n"
+              << "  frustum " << frustumSeconds * 1e6f / frustumQueries << " us per query (" << found / frustumQueries << " visible), "
+              << linearSeconds * 1e6f / frustumQueries << " us testing every box\n"
+              << "  raycast " << raySeconds * 1e6f / pointQueries << " us per ray (" << hits * 100 / pointQueries << "% hit)\n"
+              << "  nearest " << nearestSeconds * 1e6f / pointQueries << " us per query\n"
+              << "  checked " << frustumQueries << " frustums, " << checkedQueries << " rays and nearest queries against every box" << std::endl;
+    return passed;
+}
+
+int benchBvhCommand(int argc, char** argv)
+{
+    std::vector<unsigned int> sizes;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+            sizes.push_back((unsigned int)std::atoi(argv[++i]));
+        else
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (sizes.empty())
+    {
+        sizes.push_back(10000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+    bool passed = true;
+    for (unsigned int i = 0; i < sizes.size(); i++)
+        passed = benchBvh(std::max(sizes[i], 1u)) && passed;
+    return passed ? 0 : 1;
+}
+
+// bench mesh
+// ------------------------------------------------------------------------
+void printCacheStats(const char* stage, const std::vector<unsigned int>& indices, size_t vertexCount, float seconds)
+{
+    VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+    std::cout << "  " << stage << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr;
+    if (seconds >= 0.0f)
+        std::cout << " in " << seconds * 1000.0f << " ms";
+    std::cout << std::endl;
+}
+
+int benchMeshCommand(int argc, char** argv)
+{
+    unsigned int grid = 400;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+            grid = std::max(1, std::atoi(argv[++i]));
+        else
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // a bumpy grid, so the overdraw pass has sides to sort, with its triangles in random order
+    unsigned int row = grid + 1;
+    std::vector<glm::vec3> positions(row * row);
+    for (unsigned int y = 0; y < row; y++)
+        for (unsigned int x = 0; x < row; x++)
+            positions[y * row + x] = glm::vec3((float)x, std::sin((float)x * 0.3f) * std::cos((float)y * 0.3f) * 4.0f, (float)y);
+    std::vector<unsigned int> triangles(grid * grid * 2);
+    for (unsigned int t = 0; t < triangles.size(); t++)
+        triangles[t] = t;
+    std::mt19937 random(5489u);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    std::vector<unsigned int> indices;
+    indices.reserve(triangles.size() * 3);
+    for (unsigned int t = 0; t < triangles.size(); t++)
+    {
+        unsigned int quad = triangles[t] / 2, x = quad % grid, y = quad / grid;
+        unsigned int i0 = y * row + x, i1 = (y + 1) * row + x;
+        if (triangles[t] % 2 == 0)
+            indices.insert(indices.end(), { i0, i1, i0 + 1 });
+        else
+            indices.insert(indices.end(), { i0 + 1, i1, i1 + 1 });
+    }
+
+    std::cout << grid << " x " << grid << " grid, " << triangles.size() << " triangles, " << positions.size() << " vertices" << std::endl;
+    printCacheStats("shuffled", indices, positions.size(), -1.0f);
+    VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+    auto start = std::chrono::steady_clock::now();
+    MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+    printCacheStats("vertex cache", indices, positions.size(), secondsSince(start));
+    start = std::chrono::steady_clock::now();
+    MeshOptimizer::OptimizeOverdraw(indices, positions);
+    printCacheStats("overdraw", indices, positions.size(), secondsSince(start));
+
+    VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+    if (after.acmr >= before.acmr)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::CACHE_NOT_IMPROVED " << before.acmr << " -> " << after.acmr << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// check meshlets
+// ------------------------------------------------------------------------
+// the full level of one mesh after the import pipeline of Model, with its meshlets
+struct ImportedMesh
+{
+    std::string name;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    std::vector<Meshlet> meshlets;
+    AABB bounds;
+};
+
+// the meshes of path through Model::optimizeMesh, without textures or a GL context
+bool importMeshes(const std::string& path, std::vector<ImportedMesh>& meshes)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::CANNOT_IMPORT " << path << " " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        std::vector<Vertex> vertices(mesh->mNumVertices);
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            vertices[i].Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            if (mesh->mNormals)
+                vertices[i].Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            if (mesh->mTextureCoords[0])
+                vertices[i].TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+        }
+        std::vector<unsigned int> indices;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indices.insert(indices.end(), mesh->mFaces[i].mIndices, mesh->mFaces[i].mIndices + mesh->mFaces[i].mNumIndices);
+        // Model only builds meshlets for pure triangle lists
+        if (indices.size() != mesh->mNumFaces * 3)
+            continue;
+
+        ImportedMesh imported;
+        imported.name = mesh->mName.C_Str();
+        std::vector<MeshLod> lods;
+        Model::optimizeMesh(imported.name.c_str(), vertices, indices, lods, imported.meshlets);
+        indices.resize(lods[0].IndexCount);
+        imported.indices.swap(indices);
+        imported.positions.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            imported.positions[i] = vertices[i].Position;
+            imported.bounds.Extend(vertices[i].Position);
+        }
+        meshes.push_back(imported);
+    }
+    return true;
+}
+
+struct MeshletCullStats
+{
+    unsigned long long tests = 0;
+    unsigned long long coneCulled = 0;
+    unsigned long long frustumCulled = 0;
+    unsigned long long violations = 0;
+};
+
+// places mesh with random transforms in front of random cameras and culls its meshlets the way queueMeshlets() and
+// Submit() of the renderer do. every triangle of a rejected meshlet must face away from the camera or lie outside the view
+void checkMeshlets(const ImportedMesh& mesh, unsigned int trials, std::mt19937& random, MeshletCullStats& stats)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), scaleRange(0.5f, 2.0f), distanceRange(0.1f, 3.0f);
+    float meshRadius = glm::length(mesh.bounds.Extents());
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f, 1000.0f);
+    FrustumCuller culler;
+    std::vector<unsigned int> boxed;
+    std::vector<unsigned char> rejected, visible;
+    for (unsigned int trial = 0; trial < trials; trial++)
+    {
+        glm::vec3 axis = glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random)) * 20.0f);
+        model = glm::rotate(model, unit(random) * 3.1415927f, glm::normalize(axis));
+        model = glm::scale(model, glm::vec3(scaleRange(random), scaleRange(random), scaleRange(random)));
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+        // from inside the mesh to a few times its size away, looking somewhere near it
+        glm::vec3 center = glm::vec3(model * glm::vec4(mesh.bounds.Center(), 1.0f));
+        glm::vec3 direction = glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-3f, 0.0f, 0.0f);
+        glm::vec3 camera = center + glm::normalize(direction) * meshRadius * scale * distanceRange(random);
+        glm::vec3 target = center + glm::vec3(unit(random), unit(random), unit(random)) * meshRadius * scale;
+        Frustum frustum = Frustum::FromMatrix(projection * glm::lookAt(camera, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 objectCamera = glm::vec3(glm::inverse(model) * glm::vec4(camera, 1.0f));
+
+        culler.Clear();
+        boxed.clear();
+        rejected.assign(mesh.meshlets.size(), 0);
+        for (unsigned int i = 0; i < mesh.meshlets.size(); i++)
+        {
+            const Meshlet& meshlet = mesh.meshlets[i];
+            if (meshletBackfacing(meshlet.Sphere.Center, meshlet.Sphere.Radius, meshlet.ConeAxis, meshlet.ConeCutoff, objectCamera))
+            {
+                rejected[i] = 1;
+                stats.coneCulled++;
+                continue;
+            }
+            glm::vec3 sphereCenter = glm::vec3(model * glm::vec4(meshlet.Sphere.Center, 1.0f));
+            float radius = meshlet.Sphere.Radius * scale;
+            AABB box;
+            box.Min = sphereCenter - glm::vec3(radius);
+            box.Max = sphereCenter + glm::vec3(radius);
+            culler.Add(box);
+            boxed.push_back(i);
+        }
+        culler.Cull(frustum, visible);
+        for (unsigned int b = 0; b < boxed.size(); b++)
+            if (!visible[b])
+            {
+                rejected[boxed[b]] = 1;
+                stats.frustumCulled++;
+            }
+        stats.tests += mesh.meshlets.size();
+
+        for (unsigned int i = 0; i < mesh.meshlets.size(); i++)
+        {
+            if (!rejected[i])
+                continue;
+            const Meshlet& meshlet = mesh.meshlets[i];
+            for (uint32_t t = meshlet.FirstIndex; t + 2 < meshlet.FirstIndex + meshlet.IndexCount; t += 3)
+            {
+                glm::vec3 p[3];
+                AABB box;
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = glm::vec3(model * glm::vec4(mesh.positions[mesh.indices[t + k]], 1.0f));
+                    box.Extend(p[k]);
+                }
+                // the scale is positive, the winding survives the transform. edge on triangles are not drawn anyway
+                glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 view = camera - p[0];
+                bool front = glm::dot(normal, view) > 1e-5f * glm::length(normal) * glm::length(view);
+                if (front && frustum.Intersects(box))
+                {
+                    stats.violations++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int checkMeshletsCommand(int argc, char** argv)
+{
+    unsigned int trials = 1000;
+    std::vector<std::string> paths;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--trials") == 0 && i + 1 < argc)
+            trials = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i][0] == '-')
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        paths.push_back(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head.ply"));
+        paths.push_back(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01.ply"));
+        paths.push_back(FileSystem::getPath("resources/objects/bakemyscan/bakemyscan.ply"));
+    }
+
+    std::mt19937 random(5489u);
+    unsigned long long violations = 0;
+    for (unsigned int p = 0; p < paths.size(); p++)
+    {
+        std::vector<ImportedMesh> meshes;
+        if (!importMeshes(paths[p], meshes))
+            return 1;
+        for (unsigned int m = 0; m < meshes.size(); m++)
+        {
+            MeshletCullStats stats;
+            checkMeshlets(meshes[m], trials, random, stats);
+            double tests = (double)std::max(stats.tests, 1ull);
+            std::cout << paths[p] << " " << meshes[m].name << ": " << meshes[m].meshlets.size() << " meshlets, " << trials << " trials, "
+                      << stats.coneCulled * 100.0 / tests << "% cone culled, " << stats.frustumCulled * 100.0 / tests << "% frustum culled, "
+                      << stats.violations << " rejected with a visible front face" << std::endl;
+            violations += stats.violations;
+        }
+    }
+    if (violations > 0)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::MESHLET_CULL_NOT_CONSERVATIVE " << violations << " meshlets" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// bake ibl
+// ------------------------------------------------------------------------
+void printBakeStats(const char* name, const CpuCubemap& cubemap, const IBLBakeStats& stats)
+{
+    std::cout << name << " " << cubemap.size << "x" << cubemap.size << ", " << cubemap.Mips() << " mips in " << stats.seconds << "s, "
+              << stats.TexelsPerSecondPerCore() / 1e6 << "M texels/s per core on " << stats.threads << " threads" << std::endl;
+}
+
+// rms of the difference relative to the rms of the reference over every texel of one mip, and the largest difference
+float compareLevel(const CpuCubemap& bake, const CpuCubemap& reference, unsigned int mip, float& maxError)
+{
+    const std::vector<float>& a = bake.levels[mip];
+    const std::vector<float>& b = reference.levels[mip];
+    double difference = 0.0, magnitude = 0.0;
+    maxError = 0.0f;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        double d = (double)a[i] - (double)b[i];
+        difference += d * d;
+        magnitude += (double)b[i] * b[i];
+        maxError = std::max(maxError, (float)std::abs(d));
+    }
+    return magnitude > 0.0 ? (float)std::sqrt(difference / magnitude) : (difference > 0.0 ? 1.0f : 0.0f);
+}
+
+// prints the error of every mip against the reference, returns the worst relative rms. -1 when the sizes do not match
+float compareBake(const char* name, const CpuCubemap& bake, const CpuCubemap& reference)
+{
+    if (bake.size != reference.size || bake.Mips() > reference.Mips())
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::IBL_REFERENCE_SIZE " << name << " " << reference.size << "x" << reference.size << ", "
+                  << reference.Mips() << " mips" << std::endl;
+        return -1.0f;
+    }
+    float worst = 0.0f;
+    for (unsigned int mip = 0; mip < bake.Mips(); mip++)
+    {
+        float maxError;
+        float error = compareLevel(bake, reference, mip, maxError);
+        worst = std::max(worst, error);
+        std::cout << "  " << name << " mip " << mip << ": rms error " << error * 100.0f << "%, max " << maxError << std::endl;
+    }
+    return worst;
+}
+
+int bakeIblCommand(int argc, char** argv)
+{
+    std::string hdrPath = FileSystem::getPath("resources/textures/hdr/fireplace_2k.hdr");
+    std::string referencePath;
+    unsigned int threads = 0;
+    float tolerance = -1.0f;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--hdr") == 0 && i + 1 < argc)
+            hdrPath = argv[++i];
+        else if (std::strcmp(argv[i], "--reference") == 0 && i + 1 < argc)
+            referencePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            tolerance = (float)std::atof(argv[++i]);
+        else
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    bool requireReference = !referencePath.empty();
+    if (referencePath.empty())
+        referencePath = hdrPath + ".iblcache";
+
+    // the renderer caches its bake next to the hdr, its sizes are the ones to bake at
+    IBLBakeParams params;
+    CpuCubemap gpuEnvironment, gpuIrradiance, gpuPrefilter;
+    bool haveReference = IBLCache::ReadTexels(referencePath, params, gpuEnvironment, gpuIrradiance, gpuPrefilter);
+    if (!haveReference)
+    {
+        params = IBLBakeParams();
+        if (requireReference)
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::CANNOT_READ_IBL_REFERENCE " << referencePath << std::endl;
+            return 1;
+        }
+        std::cout << "no GPU bake at " << referencePath << ", run the renderer once to compare against it" << std::endl;
+    }
+    else if (params.cpuConvolution)
+        std::cout << "the reference " << referencePath << " was convolved on the CPU as well" << std::endl;
+
+    // the renderer flips the hdr so row 0 is the bottom, like the GPU samples it
+    int width, height, components;
+    stbi_set_flip_vertically_on_load(true);
+    float* data = stbi_loadf(hdrPath.c_str(), &width, &height, &components, 0);
+    stbi_set_flip_vertically_on_load(false);
+    if (!data)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::CANNOT_LOAD " << hdrPath << std::endl;
+        return 1;
+    }
+
+    IBLCpuBaker baker(threads);
+    CpuCubemap environment = baker.EquirectangularToCubemap(data, width, height, components, params.envSize);
+    stbi_image_free(data);
+    printBakeStats("environment", environment, baker.LastStats);
+    CpuCubemap irradiance = baker.BakeIrradiance(environment, params.irradianceSize);
+    printBakeStats("irradiance", irradiance, baker.LastStats);
+    CpuCubemap prefilter = baker.BakePrefilter(environment, params.prefilterSize, params.prefilterMips);
+    printBakeStats("prefilter", prefilter, baker.LastStats);
+    if (!haveReference)
+        return 0;
+
+    // every level the CPU baked, the environment with its whole mip chain
+    float worst = 0.0f;
+    const char* names[3] = { "environment", "irradiance", "prefilter" };
+    const CpuCubemap* bakes[3] = { &environment, &irradiance, &prefilter };
+    const CpuCubemap* references[3] = { &gpuEnvironment, &gpuIrradiance, &gpuPrefilter };
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        if (references[i]->Mips() == 0)
+        {
+            std::cout << "  " << names[i] << ": not in the reference" << std::endl;
+            continue;
+        }
+        float error = compareBake(names[i], *bakes[i], *references[i]);
+        if (error < 0.0f)
+            return 1;
+        worst = std::max(worst, error);
+    }
+    if (tolerance >= 0.0f && worst > tolerance)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::IBL_BAKE_MISMATCH rms error " << worst << " above " << tolerance << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// frame allocations
+// ------------------------------------------------------------------------
+// every operator new of the tool is counted, so a command can check that a stretch of code does not allocate
+std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+// gcc sees the inlined free on a pointer from operator new and flags it, both ends are ours
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    ::operator delete(memory);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocationCount++;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    ::operator delete(memory);
+}
+
+#ifdef __cpp_aligned_new
+// over-aligned types. the block malloc returned is kept in front of the aligned pointer for the delete
+void* alignedAllocate(std::size_t size, std::align_val_t alignment) noexcept
+{
+    allocationCount++;
+    std::size_t align = std::max((std::size_t)alignment, sizeof(void*));
+    void* memory = std::malloc(size + align + sizeof(void*));
+    if (!memory)
+        return nullptr;
+    std::uintptr_t aligned = ((std::uintptr_t)memory + sizeof(void*) + align - 1) & ~(std::uintptr_t)(align - 1);
+    ((void**)aligned)[-1] = memory;
+    return (void*)aligned;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    void* memory = alignedAllocate(size, alignment);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return alignedAllocate(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    if (memory)
+        std::free(((void**)memory)[-1]);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+#endif
+
+// the same as addModel of the renderer: maps the mesh cache, or imports the model and writes it first
+unsigned int addBundledModel(IndirectRenderer& renderer, MeshCache& cache, const std::string& path)
+{
+    if (cache.Load())
+        return renderer.Add(cache);
+    Model model(path);
+    if (cache.Save(model.meshes, model.materials) && cache.Load())
+        return renderer.Add(cache);
+    return renderer.Add(model);
+}
+
+// instance i of a grid, spinning with phase like the spheres of the renderer
+glm::mat4 instanceTransform(unsigned int i, unsigned int columns, float scale, float phase)
+{
+    const float spacing = 12.0f;
+    glm::vec3 position((float)(i % columns) * spacing, 0.0f, (float)(i / columns) * spacing);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    model = glm::rotate(model, phase + (float)i, glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(scale));
+}
+
+int frameAllocationsCommand(int argc, char** argv)
+{
+    unsigned int warmupFrames = 120, frames = 600, instanceCount = 64;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmupFrames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+            instanceCount = std::max(1, std::atoi(argv[++i]));
+        else
+        {
+            std::cout << "ERROR::ASSET_PIPELINE::UNKNOWN_OPTION " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "asset-pipeline", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::CANNOT_CREATE_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::CANNOT_LOAD_GL" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+
+    unsigned long long allocations = 0;
+    unsigned int lastVisible = 0, lastDraws = 0;
+    {
+        // the bundled models and their materials, loaded the way the renderer loads them
+        std::string helmetPath = FileSystem::getPath("resources/objects/free-sci-fi-helmet/");
+        std::string scanPath = FileSystem::getPath("resources/objects/bakemyscan/");
+        std::string paths[3] = { helmetPath + "head.ply", helmetPath + "visor01.ply", scanPath + "bakemyscan.ply" };
+        const float scales[3] = { 2.6f, 2.6f, 9.0f };
+        ThreadPool texturePool;
+        TextureLoader textureLoader(texturePool);
+        MaterialMaps maps[3] = {
+            loadMaterialMaps(textureLoader, helmetPath + "head_albedo.jpg", helmetPath + "head_normal.png", helmetPath + "head_metallic.jpg", helmetPath + "head_roughness.jpg", helmetPath + "head_ao.jpg", helmetPath + "head_orm.ktx"),
+            loadMaterialMaps(textureLoader, helmetPath + "visor01_albedo.jpg", helmetPath + "visor01_normal.png", helmetPath + "visor01_metallic.jpg", helmetPath + "visor01_roughness.jpg", helmetPath + "visor01_ao.jpg", helmetPath + "visor01_orm.ktx"),
+            loadMaterialMaps(textureLoader, scanPath + "albedo.jpg", scanPath + "normal.jpg", scanPath + "metallic.jpg", scanPath + "roughness.jpg", scanPath + "ao.jpg", scanPath + "orm.ktx") };
+        MeshCache head(paths[0]), visor(paths[1]), scan(paths[2]);
+        // room for every meshlet of every instance
+        IndirectRenderer renderer(instanceCount * 2048);
+        unsigned int geometries[3] = { addBundledModel(renderer, head, paths[0]), addBundledModel(renderer, visor, paths[1]), addBundledModel(renderer, scan, paths[2]) };
+        renderer.Upload();
+        head.Close();
+        visor.Close();
+        scan.Close();
+
+        // the renderer's default shading: pbr.fs with tonemapping and SH irradiance, a permutation per material
+        std::vector<std::string> pbrDefines;
+        pbrDefines.push_back("TONEMAP");
+        pbrDefines.push_back("USE_SH_IRRADIANCE");
+        ShaderPermutations pbrShaders(FileSystem::getPath("src/physically-rendering/pbr.vs"), FileSystem::getPath("src/physically-rendering/pbr.fs"), pbrDefines);
+
+        SceneBVH scene;
+        std::vector<SceneObject> sceneObjects;
+        unsigned int columns = (unsigned int)std::ceil(std::sqrt((float)instanceCount));
+        for (unsigned int i = 0; i < instanceCount; i++)
+        {
+            SceneObject object = { geometries[i % 3], pbrShaders.Get(materialDefines(maps[i % 3])), &maps[i % 3], "" };
+            sceneObjects.push_back(object);
+            scene.Add(renderer.Bounds(geometries[i % 3]), instanceTransform(i, columns, scales[i % 3], 0.0f));
+        }
+        scene.Build();
+
+        // six lights swinging above the grid like the animated ones of the renderer
+        glm::vec3 center = glm::vec3((float)(columns - 1) * 6.0f, 0.0f, (float)((instanceCount - 1) / columns) * 6.0f);
+        LightBuffer lightBuffer(2, 6);
+        std::vector<Light_Info> animatedLights;
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            float angle = 6.2831853f * (float)i / 6.0f;
+            Light_Info light = { glm::vec4(center + glm::vec3(std::cos(angle) * 10.0f, 10.0f, std::sin(angle) * 10.0f), 40.0f), glm::vec4(300.0f, 300.0f, 300.0f, 0.0f) };
+            lightBuffer.Add(light);
+            animatedLights.push_back(light);
+        }
+
+        const float fovY = glm::radians(45.0f);
+        glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 1000.0f);
+        LightClusters lightClusters(false);
+        lightClusters.SetProjection(projection, 0.1f, 1000.0f);
+        FrameDataBuffer frameData;
+        FrameRing<Object_Info> objectRing(instanceCount, GL_SHADER_STORAGE_BUFFER, 5);
+
+        // the frame of the renderer without its IBL textures and background, the hidden window is only drawn into
+        PbrFrame pbrFrame(textureLoader, lightBuffer, lightClusters, frameData, pbrShaders, objectRing, renderer, scene, sceneObjects);
+        pbrFrame.SetAnimatedLights(animatedLights);
+
+        // the camera circles the grid once per warm-up, so the counted frames replay views the warm-up has seen.
+        // counting also waits for the material maps, their uploads belong to loading and not to the steady frame
+        float orbit = (float)columns * 8.0f + 10.0f;
+        unsigned long long countedFrom = 0;
+        for (unsigned int frame = 0, counted = 0; counted < frames; frame++)
+        {
+            bool counting = frame >= warmupFrames && textureLoader.Pending() == 0;
+            if (counting && counted == 0)
+                countedFrom = allocationCount;
+            float phase = 6.2831853f * (float)(frame % warmupFrames) / (float)warmupFrames;
+            for (unsigned int i = 0; i < instanceCount; i++)
+                scene.SetTransform(i, instanceTransform(i, columns, scales[i % 3], phase));
+
+            glm::vec3 eye = center + glm::vec3(std::cos(phase) * orbit, 6.0f + 4.0f * std::sin(2.0f * phase), std::sin(phase) * orbit);
+            FrameData data = FrameData::Camera(glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)), projection, (float)frame / 60.0f);
+            pbrFrame.Render(data, fovY, 1.0f, 1920, 1080, []() {});
+            lastVisible = (unsigned int)pbrFrame.VisibleInstances().size();
+            lastDraws = renderer.Visible();
+            if (counting)
+                counted++;
+        }
+        glFinish();
+        allocations = allocationCount - countedFrom;
+    }
+    glfwTerminate();
+
+    std::cout << frames << " frames after " << warmupFrames << " warm-up frames, " << instanceCount << " instances (" << lastVisible << " visible, "
+              << lastDraws << " draws on the last frame): " << allocations << " allocations" << std::endl;
+    if (allocations > 0)
+    {
+        std::cout << "ERROR::ASSET_PIPELINE::FRAME_ALLOCATES " << (double)allocations / frames << " allocations per frame" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,12 +1,26 @@
-#version 330 core
+#version 460 core
 out vec4 FragColor;
 in vec3 WorldPos;
 
 uniform samplerCube environmentMap;
 
+// same block as in background.vs
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec3 camPos;
+    float time;
+    float exposure;
+};
+
 void main()
 {	
-    vec3 envColor = textureLod(environmentMap, WorldPos, 0.0).rgb;
+    vec3 envColor = textureLod(environmentMap, WorldPos, 0.0).rgb * exposure;
     
     // HDR tonemap and gamma correct
     envColor = envColor / (envColor + vec3(1.0));
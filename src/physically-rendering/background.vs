@@ -1,8 +1,19 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// the camera of the frame, see FrameDataBuffer
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec3 camPos;
+    float time;
+    float exposure;
+};
 
 out vec3 WorldPos;
 
@@ -0,0 +1,26 @@
+#version 460 core
+// one invocation per cube face, each emits the cube into its own layer of the layered framebuffer.
+// a single draw fills all six faces of the bound mip
+layout (triangles, invocations = 6) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 LocalPos[];
+out vec3 WorldPos;
+
+// projection * view of every face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+layout (std140, binding = 1) uniform CubeFaces
+{
+    mat4 faceViewProjection[6];
+};
+
+void main()
+{
+    gl_Layer = gl_InvocationID;
+    for (int i = 0; i < 3; i++)
+    {
+        WorldPos = LocalPos[i];
+        gl_Position = faceViewProjection[gl_InvocationID] * vec4(LocalPos[i], 1.0);
+        EmitVertex();
+    }
+    EndPrimitive();
+}
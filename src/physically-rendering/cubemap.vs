@@ -1,21 +1,11 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 
-out vec3 WorldPos;
-
-//uniform mat4 projection;
-//uniform mat4 view;
-
-//use ubo to upload view and projection matrix
-layout (std140) uniform Matrices
-{
-    mat4 projection;
-    mat4 view;
-};
-
+// the cube stays in object space, cubemap.gs projects it once per face
+out vec3 LocalPos;
 
 void main()
 {
-    WorldPos = aPos;  
-    gl_Position =  projection * view * vec4(WorldPos, 1.0);
-}
\ No newline at end of file
+    LocalPos = aPos;
+    gl_Position = vec4(aPos, 1.0);
+}
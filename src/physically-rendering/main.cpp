@@ -1,6 +1,8 @@
 ﻿//10/08/2022
 //ZHENGYANG HE
 //Newcastle University
+// windows.h, through mapped_file.h, has to come before glad: both define APIENTRY
+#include <learnopengl/mapped_file.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <stb_image.h>
@@ -11,9 +13,26 @@
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_c.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <learnopengl/ibl_cache.h>
+#include <learnopengl/ibl_cpu_baker.h>
+#include <learnopengl/ibl_compute_baker.h>
+#include <learnopengl/brdf_lut.h>
+#include <learnopengl/frame_data.h>
+#include <learnopengl/frame_ring.h>
+#include <learnopengl/indirect_renderer.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/pbr_frame.h>
+#include <learnopengl/scene_bvh.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/texture_loader.h>
+
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 //#include <vector>
 
@@ -21,16 +40,41 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
-void renderSphere();
+unsigned int addSphere(IndirectRenderer& renderer);
+unsigned int addModel(IndirectRenderer& renderer, MeshCache& cache, const std::string& path);
 void renderCube();
 void renderQuad();
-void renderPbrSphere(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, float circleR, float theta, float radian, Shader& pbrShader);
-void renderPbrModel(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, float circleR, float theta, float radian, Shader& pbrShader, Model inputModel, glm::mat4 model);
+void placePbrSphere(SceneBVH& scene, unsigned int instance, float circleR, float theta, float radian);
+void placePbrModel(SceneBVH& scene, unsigned int instance, glm::mat4 model);
 
 // settings
 const unsigned int SCR_WIDTH = 1920;
 const unsigned int SCR_HEIGHT = 1080;
+// run the irradiance and prefilter convolutions on the CPU thread pool instead of as fragment passes
+const bool bakeIBLOnCpu = false;
+// bake the environment, irradiance, prefilter and brdf lut with compute shaders instead of raster passes
+const bool bakeIBLWithCompute = true;
+// diffuse IBL from 9 spherical harmonics coefficients instead of the convolved irradiance cubemap
+const bool useSHIrradiance = true;
+// closed form split sum approximation instead of the BRDF LUT, for machines where the extra texture fetch hurts
+const bool useAnalyticBRDF = false;
+// records per frame in the object ring, one per object
+const unsigned int maxObjects = 1024;
+// indirect commands per frame, one per mesh of every object
+const unsigned int maxDraws = 4096;
+// small static lights scattered around the spheres on top of the six animated ones, raise to stress the light culling
+const unsigned int sceneryLightCount = 0;
+// build the clustered light lists with light_cull.comp instead of on the CPU
+const bool cullLightsOnGpu = false;
+// scene color scale before tonemapping, pbr.fs and background.fs read it from FrameData
+const float exposure = 1.0f;
+// screen space error in pixels a coarser level of detail may have before the renderer keeps a finer one
+const float lodPixelError = 1.0f;
+// drop meshlets facing away from the camera. GL_CULL_FACE is off, so open meshes like the visor show their back faces
+// and would lose them. only turn it on for scenes of closed meshes
+const bool cullBackfacingMeshlets = false;
+// cull meshlets with meshlet_cull.comp instead of on the CPU
+const bool cullMeshletsOnGpu = false;
 
 // camera
 Camera camera(glm::vec3(5.0f, 0.0f, 15.0f));
@@ -42,11 +86,11 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-//creat struct for ssbo
-struct Light_Info
+// shaders, meshes and buffers delete their GL objects in their destructors, which run when main returns.
+// this guard is declared before all of them, so glfw (and the context) goes away only after they are destroyed
+struct GlfwTerminator
 {
-    glm::vec4 position;
-    glm::vec4 color;
+    ~GlfwTerminator() { glfwTerminate(); }
 };
 
 //vector<Light_Info> Light_Array_Info;
@@ -55,6 +99,7 @@ struct Light_Info
 int main()
 {
     // glfw init
+    GlfwTerminator glfwTerminator;
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -92,17 +137,16 @@ int main()
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     // Shader
-    Shader pbrShader("pbr.vs", "pbr.fs");
-    Shader equirectangularToCubemapShader("cubemap.vs", "equirectangular_to_cubemap.fs");
-    Shader prefilterShader("cubemap.vs", "prefilter.fs");
-    Shader irradianceShader("cubemap.vs", "irradiance_convolution.fs");
-    Shader brdfShader("brdf.vs", "brdf.fs");
+    // ------pbr.fs is compiled once per combination of features the materials need, the scene wide ones are shared
+    std::vector<std::string> pbrDefines;
+    pbrDefines.push_back("TONEMAP");
+    if (useSHIrradiance)
+        pbrDefines.push_back("USE_SH_IRRADIANCE");
+    if (useAnalyticBRDF)
+        pbrDefines.push_back("USE_ANALYTIC_BRDF");
+    ShaderPermutations pbrShaders("pbr.vs", "pbr.fs", pbrDefines);
     Shader backgroundShader("background.vs", "background.fs");
 
-    pbrShader.use();
-    pbrShader.setInt("irradianceMap", 0);
-    pbrShader.setInt("prefilterMap", 1);
-    pbrShader.setInt("brdfLUT", 2);
     //pbrShader.setInt("albedoMap", 3);
     //pbrShader.setInt("normalMap", 4);
     //pbrShader.setInt("metallicMap", 5);
@@ -110,48 +154,13 @@ int main()
     //pbrShader.setInt("aoMap", 7);
 
     
-    //create a ubo to store pbr texture's handle id
-    unsigned int uniformBlockIndexPbrMaterial = glGetUniformBlockIndex(pbrShader.ID, "pbrMaterial");
-    glUniformBlockBinding(pbrShader.ID, uniformBlockIndexPbrMaterial, 11);
-    unsigned int pbrMaterialUBO;
-    glGenBuffers(1, &pbrMaterialUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, pbrMaterialUBO);
-    glBufferData(GL_UNIFORM_BUFFER, 6 * sizeof(GLuint64), NULL, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    // define the range of the buffer that links to a uniform binding point
-    glBindBufferRange(GL_UNIFORM_BUFFER, 11, pbrMaterialUBO, 0, 6 * sizeof(GLuint64));
-
-    //creat matrices ubo
-    //get the relevant block indices
-    unsigned int uniformBlockIndexEqu = glGetUniformBlockIndex(equirectangularToCubemapShader.ID, "Matrices");
-    unsigned int uniformBlockIndexPre = glGetUniformBlockIndex(prefilterShader.ID, "Matrices");
-    unsigned int uniformBlockIndexIrr = glGetUniformBlockIndex(irradianceShader.ID, "Matrices");
-    //link each shader's uniform block to this uniform binding point
-    glUniformBlockBinding(equirectangularToCubemapShader.ID, uniformBlockIndexEqu, 0);
-    glUniformBlockBinding(prefilterShader.ID, uniformBlockIndexPre, 0);
-    glUniformBlockBinding(irradianceShader.ID, uniformBlockIndexIrr, 0);
-    //create the buffer
-    unsigned int uboMatrices;
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    // define the range of the buffer that links to a uniform binding point
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboMatrices, 0, 2 * sizeof(glm::mat4));
-
-    //creat light info ssbo
-    //get the relevant block indices
-    unsigned int ssboBlockIndexPbr = 0;
-    ssboBlockIndexPbr = glGetProgramResourceIndex(pbrShader.ID, GL_SHADER_STORAGE_BLOCK, "Light_Data");
-    //link each shader's uniform block to this uniform binding point
-    glShaderStorageBlockBinding(pbrShader.ID, ssboBlockIndexPbr, 2);
-    //create the buffer
-    unsigned int ssboLight;
-    glGenBuffers(1, &ssboLight);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboLight);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 6 * sizeof(Light_Info), NULL, GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssboLight);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    // transform and material handles of every object, written once per frame into a mapped ssbo ring (binding 5).
+    // each draw picks its record through gl_BaseInstance, so drawing an object is a single draw call
+    FrameRing<Object_Info> objectRing(maxObjects, GL_SHADER_STORAGE_BUFFER, 5);
+
+    //creat light info ssbo, pbr.fs declares it at binding 2
+    //create the buffer, it grows with the light count and only uploads the lights that changed
+    LightBuffer lightBuffer(2, 6 + sceneryLightCount);
     
     backgroundShader.use();
     backgroundShader.setInt("environmentMap", 0);
@@ -159,44 +168,46 @@ int main()
     const int sphereNum = 8;
     std::string inputPath = "resources/textures/pbr";
     std::string twoInputPath[] = { "/gold/", "/slipperystonework/", "/ornate-celtic-gold/", "/bamboo-wood-semigloss/", "/wornpaintedcement/", "/paint-peeling/", "/Titanium-Scuffed/", "/wrinkled-paper/" };
-    std::string allTextureName[] = { "albedo.png", "normal.png", "metallic.png", "roughness.png", "ao.png" };
-    unsigned int sphereMap[sphereNum][5];
+    MaterialMaps sphereMaps[sphereNum];
+
+    // material textures
+    // ------decoded on worker threads, each map draws as a flat placeholder until textureLoader.Update() uploaded it.
+    // ------materials that went through asset-pipeline pack-orm sample one orm.ktx instead of three maps
+    ThreadPool texturePool;
+    TextureLoader textureLoader(texturePool);
     
     for (int i = 0; i < sphereNum; i++)
     {
-        std::string tempInputPath = inputPath + twoInputPath[i];
-        for (int j = 0; j < 5; j++)
-        {
-            std::string lastInputPath = tempInputPath + allTextureName[j];
-            sphereMap[i][j] = loadTexture(FileSystem::getPath(lastInputPath).c_str());
-        }
+        std::string materialPath = FileSystem::getPath(inputPath + twoInputPath[i]);
+        sphereMaps[i] = loadMaterialMaps(textureLoader, materialPath + "albedo.png", materialPath + "normal.png", materialPath + "metallic.png", materialPath + "roughness.png", materialPath + "ao.png", materialPath + "orm.ktx");
     }
 
-    stbi_set_flip_vertically_on_load(false);
-
     // init model pbr texture's handle id
-    int modelAlbedoMap = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head_albedo.jpg").c_str());
-    int modelNormalMap = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head_normal.png").c_str());
-    int modelMetallicMap = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head_metallic.jpg").c_str());
-    int modelRoughnessMap = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head_roughness.jpg").c_str());
-    int modelAoMapModel = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head_ao.jpg").c_str());
-
-    int modelAlbedoMap2 = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01_albedo.jpg").c_str());
-    int modelNormalMap2 = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01_normal.png").c_str());
-    int modelMetallicMap2 = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01_metallic.jpg").c_str());
-    int modelRoughnessMap2 = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01_roughness.jpg").c_str());
-    int modelAoMapModel2 = loadTexture(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01_ao.jpg").c_str());
-
-    int modelAlbedoMap3 = loadTexture(FileSystem::getPath("resources/objects/bakemyscan/albedo.jpg").c_str());
-    int modelNormalMap3 = loadTexture(FileSystem::getPath("resources/objects/bakemyscan/normal.jpg").c_str());
-    int modelMetallicMap3 = loadTexture(FileSystem::getPath("resources/objects/bakemyscan/metallic.jpg").c_str());
-    int modelRoughnessMap3 = loadTexture(FileSystem::getPath("resources/objects/bakemyscan/roughness.jpg").c_str());
-    int modelAoMapModel3 = loadTexture(FileSystem::getPath("resources/objects/bakemyscan/ao.jpg").c_str());
+    std::string helmetPath = FileSystem::getPath("resources/objects/free-sci-fi-helmet/");
+    MaterialMaps headMaps = loadMaterialMaps(textureLoader, helmetPath + "head_albedo.jpg", helmetPath + "head_normal.png", helmetPath + "head_metallic.jpg", helmetPath + "head_roughness.jpg", helmetPath + "head_ao.jpg", helmetPath + "head_orm.ktx");
+    MaterialMaps visorMaps = loadMaterialMaps(textureLoader, helmetPath + "visor01_albedo.jpg", helmetPath + "visor01_normal.png", helmetPath + "visor01_metallic.jpg", helmetPath + "visor01_roughness.jpg", helmetPath + "visor01_ao.jpg", helmetPath + "visor01_orm.ktx");
+    std::string scanPath = FileSystem::getPath("resources/objects/bakemyscan/");
+    MaterialMaps scanMaps = loadMaterialMaps(textureLoader, scanPath + "albedo.jpg", scanPath + "normal.jpg", scanPath + "metallic.jpg", scanPath + "roughness.jpg", scanPath + "ao.jpg", scanPath + "orm.ktx");
 
     // init model
-    Model head(FileSystem::getPath("resources/objects/free-sci-fi-helmet/head.ply"));
-    Model visor(FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01.ply"));
-    Model bakemyscan(FileSystem::getPath("resources/objects/bakemyscan/bakemyscan.ply"));
+    // ------the meshes are mapped from a .meshcache next to each model, only the first run (or an edited model) goes through Assimp
+    std::string headModelPath = FileSystem::getPath("resources/objects/free-sci-fi-helmet/head.ply");
+    std::string visorModelPath = FileSystem::getPath("resources/objects/free-sci-fi-helmet/visor01.ply");
+    std::string scanModelPath = FileSystem::getPath("resources/objects/bakemyscan/bakemyscan.ply");
+    MeshCache headMesh(headModelPath), visorMesh(visorModelPath), scanMesh(scanModelPath);
+
+    // all static geometry shares one vertex and one index arena, the opaque pass is one glMultiDrawElementsIndirect
+    IndirectRenderer renderer(maxDraws, cullMeshletsOnGpu);
+    renderer.SetConeCulling(cullBackfacingMeshlets);
+    unsigned int sphereGeometry = addSphere(renderer);
+    unsigned int headGeometry = addModel(renderer, headMesh, headModelPath);
+    unsigned int visorGeometry = addModel(renderer, visorMesh, visorModelPath);
+    unsigned int bakemyscanGeometry = addModel(renderer, scanMesh, scanModelPath);
+    renderer.Upload();
+    // the streams are in the arenas now
+    headMesh.Close();
+    visorMesh.Close();
+    scanMesh.Close();
 
     // lights
     // ------init lights position and color
@@ -217,217 +228,350 @@ int main()
         glm::vec3(0.2f, 300.0f, 0.6f)
 
     };
+    // distance where the falloff of each light reaches 0
+    float lightRadii[] = { 40.0f, 40.0f, 40.0f, 40.0f, 40.0f, 40.0f };
+    const unsigned int lightCount = sizeof(lightPositions) / sizeof(lightPositions[0]);
+    std::vector<Light_Info> animatedLights;
+    for (unsigned int i = 0; i < lightCount; ++i)
+    {
+        Light_Info light = { glm::vec4(lightPositions[i], lightRadii[i]), glm::vec4(lightColors[i], 0.0f) };
+        lightBuffer.Add(light);
+        animatedLights.push_back(light);
+    }
+    // scenery lights on a golden angle spiral around the spheres, they never move so they are uploaded once
+    for (unsigned int i = 0; i < sceneryLightCount; ++i)
+    {
+        float y = 1.0f - 2.0f * ((float)i + 0.5f) / (float)sceneryLightCount;
+        float ring = std::sqrt(1.0f - y * y);
+        float phi = (float)i * 2.39996323f;
+        glm::vec3 position = 7.0f * glm::vec3(std::cos(phi) * ring, y, std::sin(phi) * ring);
+        glm::vec3 color = 20.0f * glm::vec3(0.5f + 0.5f * std::cos(phi), 0.5f + 0.5f * std::cos(phi + 2.094f), 0.5f + 0.5f * std::cos(phi + 4.189f));
+        Light_Info light = { glm::vec4(position, 4.0f), glm::vec4(color, 0.0f) };
+        lightBuffer.Add(light);
+    }
     int nrRows = 7;
     int nrColumns = 7;
     float spacing = 2.5;
 
-    // set framebuffer to cubemap
-    unsigned int captureFBO;
-    unsigned int captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-    // load pbr
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrComponents;
-    float *data = stbi_loadf(FileSystem::getPath("resources/textures/hdr/fireplace_2k.hdr").c_str(), &width, &height, &nrComponents, 0);
-    unsigned int hdrTexture;
-    if (data)
+    // ibl precompute
+    // ------the baked textures are cached next to the hdr, only bake when the hdr, bake shaders or sizes changed
+    IBLBakeParams bakeParams;
+    bakeParams.cpuConvolution = bakeIBLOnCpu;
+    bakeParams.computeBake = bakeIBLWithCompute;
+    bakeParams.shIrradiance = useSHIrradiance;
+    std::string hdrPath = FileSystem::getPath("resources/textures/hdr/fireplace_2k.hdr");
+    IBLCache iblCache(hdrPath, bakeParams, { "cubemap.vs", "cubemap.gs", "equirectangular_to_cubemap.fs", "irradiance_convolution.fs", "prefilter.fs",
+        "equirectangular_to_cubemap.comp", "irradiance_convolution.comp", "prefilter.comp" });
+    unsigned int envCubemap, irradianceMap = 0, prefilterMap;
+    if (iblCache.Load(envCubemap, irradianceMap, prefilterMap))
     {
-        glGenTextures(1, &hdrTexture);
-        glBindTexture(GL_TEXTURE_2D, hdrTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        std::cout << "Loaded IBL from cache " << iblCache.CachePath << std::endl;
     }
     else
     {
-        std::cout << "Failed to load HDR image." << std::endl;
-    }
+        // load pbr
+        // ------flipped by hand, the stb_image flip flag is global and the texture loader is decoding right now
+        int width, height, nrComponents;
+        float *data = stbi_loadf(hdrPath.c_str(), &width, &height, &nrComponents, 0);
+        unsigned int hdrTexture = 0;
+        if (data)
+        {
+            TextureLoader::FlipRows(data, width * nrComponents * sizeof(float), height);
+            glGenTextures(1, &hdrTexture);
+            glBindTexture(GL_TEXTURE_2D, hdrTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); 
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else
+        {
+            std::cout << "Failed to load HDR image." << std::endl;
+        }
 
-    // pbr set cubemap
-    unsigned int envCubemap;
-    glGenTextures(1, &envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // pbr framebuffer camera
-    glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glm::mat4 captureViews[] =
-    {
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
+        // the cpu convolutions work straight from the hdr pixels, the gpu env cubemap is then only used for the background
+        bool convolveOnCpu = bakeParams.cpuConvolution && data;
+        if (bakeParams.computeBake)
+        {
+            // compute bake
+            // ------every pass writes the cubemap levels with imageStore, no framebuffer, depth buffer or cube mesh
+            IBLComputeBaker computeBaker;
+            envCubemap = computeBaker.EquirectangularToCubemap(hdrTexture, bakeParams.envSize);
+            std::cout << "GPU environment bake: " << computeBaker.LastStats.seconds << "s, " << computeBaker.LastStats.TexelsPerSecondPerCore() << " texels/s" << std::endl;
+            if (!convolveOnCpu)
+            {
+                if (!bakeParams.shIrradiance)
+                {
+                    irradianceMap = computeBaker.BakeIrradiance(envCubemap, bakeParams.envSize, bakeParams.irradianceSize);
+                    std::cout << "GPU irradiance bake: " << computeBaker.LastStats.seconds << "s, " << computeBaker.LastStats.TexelsPerSecondPerCore() << " texels/s" << std::endl;
+                }
+                prefilterMap = computeBaker.BakePrefilter(envCubemap, bakeParams.envSize, bakeParams.prefilterSize, bakeParams.prefilterMips);
+                std::cout << "GPU prefilter bake: " << computeBaker.LastStats.seconds << "s, " << computeBaker.LastStats.TexelsPerSecondPerCore() << " texels/s" << std::endl;
+            }
+        }
+        else
+        {
+            // Shader
+            // ------cubemap.gs draws the cube into all six faces at once, so every bake pass is a single draw
+            Shader equirectangularToCubemapShader("cubemap.vs", "equirectangular_to_cubemap.fs", "cubemap.gs");
+            Shader prefilterShader("cubemap.vs", "prefilter.fs", "cubemap.gs");
+            Shader irradianceShader("cubemap.vs", "irradiance_convolution.fs", "cubemap.gs");
+
+            // set framebuffer to cubemap
+            // ------the whole cubemap level is attached as a layered target. the camera sits inside the cube, every
+            // texel sees exactly one of its faces, so no depth buffer is needed
+            unsigned int captureFBO;
+            glGenFramebuffers(1, &captureFBO);
+
+            // pbr set cubemap
+            glGenTextures(1, &envCubemap);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+            for (unsigned int i = 0; i < 6; ++i)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, bakeParams.envSize, bakeParams.envSize, 0, GL_RGB, GL_FLOAT, nullptr);
+            }
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            // pbr framebuffer camera
+            glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+            glm::mat4 captureViews[] =
+            {
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+            };
+            // the six face matrices go into the CubeFaces block of cubemap.gs once, for every pass
+            glm::mat4 captureViewProjections[6];
+            for (unsigned int i = 0; i < 6; ++i)
+                captureViewProjections[i] = captureProjection * captureViews[i];
+            unsigned int captureFacesUBO;
+            glGenBuffers(1, &captureFacesUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, captureFacesUBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(captureViewProjections), captureViewProjections, GL_STATIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, 1, captureFacesUBO);
 
-    // equirectangular map to Cubemap 
-    equirectangularToCubemapShader.use();
-    equirectangularToCubemapShader.setInt("equirectangularMap", 0);
-   // equirectangularToCubemapShader.setMat4("projection", captureProjection);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(captureProjection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            // equirectangular map to Cubemap 
+            equirectangularToCubemapShader.use();
+            equirectangularToCubemapShader.setInt("equirectangularMap", 0);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, hdrTexture);
 
-    glViewport(0, 0, 512, 512); 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        //equirectangularToCubemapShader.setMat4("view", captureViews[i]);
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(captureViews[i]));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, bakeParams.envSize, bakeParams.envSize); 
+            glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, envCubemap, 0);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderCube();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);  
+            glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+            glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    // irradiance cubemap
-    unsigned int irradianceMap;
-    glGenTextures(1, &irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    irradianceShader.use();
-    irradianceShader.setInt("environmentMap", 0);
-    //irradianceShader.setMat4("projection", captureProjection);
+            if (!convolveOnCpu)
+            {
+                // irradiance cubemap, not needed when the diffuse term comes from spherical harmonics
+                if (!bakeParams.shIrradiance)
+                {
+                    glGenTextures(1, &irradianceMap);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+                    for (unsigned int i = 0; i < 6; ++i)
+                    {
+                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, bakeParams.irradianceSize, bakeParams.irradianceSize, 0, GL_RGB, GL_FLOAT, nullptr);
+                    }
+                    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+                    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+                    irradianceShader.use();
+                    irradianceShader.setInt("environmentMap", 0);
     
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+                    glViewport(0, 0, bakeParams.irradianceSize, bakeParams.irradianceSize); 
+                    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+                    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, irradianceMap, 0);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    renderCube();
+                    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                }
 
-    glViewport(0, 0, 32, 32); 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        //irradianceShader.setMat4("view", captureViews[i]);
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(captureViews[i]));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                // pbr prefileter
+                glGenTextures(1, &prefilterMap);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+                for (unsigned int i = 0; i < 6; ++i)
+                {
+                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, bakeParams.prefilterSize, bakeParams.prefilterSize, 0, GL_RGB, GL_FLOAT, nullptr);
+                }
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); 
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                // only the baked roughness levels exist for sampling and for the cache
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, bakeParams.prefilterMips - 1);
+                glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+                // prefileter cubemap
+                prefilterShader.use();
+                prefilterShader.setInt("environmentMap", 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+                glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+                unsigned int maxMipLevels = bakeParams.prefilterMips;
+                for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+                {
+                    // reisze viewport according to mip-level size, one draw covers the six faces of the mip
+                    unsigned int mipWidth = bakeParams.prefilterSize * std::pow(0.5, mip);
+                    unsigned int mipHeight = bakeParams.prefilterSize * std::pow(0.5, mip);
+                    glViewport(0, 0, mipWidth, mipHeight);
+                    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, prefilterMap, mip);
+
+                    float roughness = (float)mip / (float)(maxMipLevels - 1);
+                    prefilterShader.setFloat("roughness", roughness);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    renderCube();
+                }
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
 
-    // pbr prefileter
-    unsigned int prefilterMap;
-    glGenTextures(1, &prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    // prefileter cubemap
-    prefilterShader.use();
-    prefilterShader.setInt("environmentMap", 0);
-    //prefilterShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    unsigned int maxMipLevels = 5;
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
-    {
-        // reisze framebuffer according to mip-level size.
-        unsigned int mipWidth = 128 * std::pow(0.5, mip);
-        unsigned int mipHeight = 128 * std::pow(0.5, mip);
-        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
-
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
-        prefilterShader.setFloat("roughness", roughness);
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            //prefilterShader.setMat4("view", captureViews[i]);
-            glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-            glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(captureViews[i]));
-            glBindBuffer(GL_UNIFORM_BUFFER, 0);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+            glDeleteFramebuffers(1, &captureFBO);
+            glDeleteBuffers(1, &captureFacesUBO);
+        }
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            renderCube();
+        if (convolveOnCpu)
+        {
+            IBLCpuBaker cpuBaker;
+            CpuCubemap cpuEnvironment = cpuBaker.EquirectangularToCubemap(data, width, height, nrComponents, bakeParams.envSize);
+            if (!bakeParams.shIrradiance)
+            {
+                CpuCubemap cpuIrradiance = cpuBaker.BakeIrradiance(cpuEnvironment, bakeParams.irradianceSize);
+                std::cout << "CPU irradiance bake: " << cpuBaker.LastStats.seconds << "s, " << cpuBaker.LastStats.TexelsPerSecondPerCore() << " texels/s per core" << std::endl;
+                irradianceMap = cpuIrradiance.Upload(GL_LINEAR);
+            }
+            CpuCubemap cpuPrefilter = cpuBaker.BakePrefilter(cpuEnvironment, bakeParams.prefilterSize, bakeParams.prefilterMips);
+            std::cout << "CPU prefilter bake: " << cpuBaker.LastStats.seconds << "s, " << cpuBaker.LastStats.TexelsPerSecondPerCore() << " texels/s per core" << std::endl;
+            prefilterMap = cpuPrefilter.Upload(GL_LINEAR_MIPMAP_LINEAR);
         }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        stbi_image_free(data);
 
-    // add brdf
-    unsigned int brdfLUTTexture;
-    glGenTextures(1, &brdfLUTTexture);
+        // keep the result for the next start, unless the hdr was missing and we baked black textures
+        if (hdrTexture != 0)
+            iblCache.Save(envCubemap, irradianceMap, prefilterMap);
 
-    // pre-allocate enough memory for the LUT texture.
-    glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // the bake resources are only needed once, the bake shaders go with their scopes
+        glDeleteTextures(1, &hdrTexture);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+    }
 
-    glViewport(0, 0, 512, 512);
-    brdfShader.use();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    renderQuad();
+    // brdf lut
+    // ------shipped in resources (asset-pipeline brdf-lut), baked once with brdf.comp (or brdf.fs) and written there if it is missing
+    unsigned int brdfLUTTexture = 0;
+    if (!useAnalyticBRDF)
+    {
+        std::string brdfLUTPath = FileSystem::getPath("resources/textures/brdf_lut.bin");
+        BrdfLut brdfLUT;
+        if (brdfLUT.Load(brdfLUTPath))
+        {
+            brdfLUTTexture = brdfLUT.Upload();
+        }
+        else if (bakeIBLWithCompute)
+        {
+            // brdf.comp also writes the multiscatter channel, so the baked file matches the shipped one
+            std::cout << "BRDF LUT not found, baking " << brdfLUTPath << std::endl;
+            IBLComputeBaker computeBaker;
+            brdfLUTTexture = computeBaker.BakeBrdfLut(BrdfLut::DEFAULT_SIZE);
+            std::cout << "GPU BRDF LUT bake: " << computeBaker.LastStats.seconds << "s, " << computeBaker.LastStats.TexelsPerSecondPerCore() << " texels/s" << std::endl;
+            BrdfLut::ReadBack(brdfLUTTexture, BrdfLut::DEFAULT_SAMPLES, 3).Save(brdfLUTPath);
+        }
+        else
+        {
+            std::cout << "BRDF LUT not found, baking " << brdfLUTPath << std::endl;
+            Shader brdfShader("brdf.vs", "brdf.fs");
+
+            // pre-allocate enough memory for the LUT texture.
+            glGenTextures(1, &brdfLUTTexture);
+            glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BrdfLut::DEFAULT_SIZE, BrdfLut::DEFAULT_SIZE, 0, GL_RG, GL_FLOAT, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            unsigned int brdfFBO;
+            glGenFramebuffers(1, &brdfFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, brdfFBO);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+
+            glViewport(0, 0, BrdfLut::DEFAULT_SIZE, BrdfLut::DEFAULT_SIZE);
+            glDisable(GL_DEPTH_TEST);
+            brdfShader.use();
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderQuad();
+            glEnable(GL_DEPTH_TEST);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &brdfFBO);
+
+            BrdfLut::ReadBack(brdfLUTTexture).Save(brdfLUTPath);
+        }
+    }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // spherical harmonics irradiance
+    // ------projected from the env cubemap every start, it is a single work group over a 64x64 mip
+    unsigned int shIrradianceUBO;
+    glGenBuffers(1, &shIrradianceUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, shIrradianceUBO);
+    glBufferData(GL_UNIFORM_BUFFER, 9 * sizeof(glm::vec4), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (useSHIrradiance)
+    {
+        unsigned int shSourceSize = std::min(64u, bakeParams.envSize);
+        ComputeShader shProjectShader("sh_project.comp");
+        shProjectShader.use();
+        shProjectShader.setInt("environmentMap", 0);
+        shProjectShader.setInt("faceSize", shSourceSize);
+        shProjectShader.setFloat("sourceLod", std::log2((float)bakeParams.envSize / (float)shSourceSize));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, shIrradianceUBO);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_UNIFORM_BARRIER_BIT);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, 4, shIrradianceUBO);
 
     // projection
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    pbrShader.use();
-    pbrShader.setMat4("projection", projection);
-    backgroundShader.use();
-    backgroundShader.setMat4("projection", projection);
+    const float nearPlane = 0.1f;
+    const float farPlane = 100.0f;
+    // the projection is built once, lod selection has to use its field of view rather than the live camera zoom
+    const float fovY = glm::radians(camera.Zoom);
+    glm::mat4 projection = glm::perspective(fovY, (float)SCR_WIDTH / (float)SCR_HEIGHT, nearPlane, farPlane);
+    pbrShaders.SetSetup([](Shader& shader)
+    {
+        shader.use();
+        shader.setInt("irradianceMap", 0);
+        shader.setInt("prefilterMap", 1);
+        shader.setInt("brdfLUT", 2);
+    });
+
+    // camera matrices, position, time and exposure of every frame, one uniform block shared by all programs
+    FrameDataBuffer frameData;
+
+    // clustered light culling, pbr.fs only shades the lights listed for its cluster
+    LightClusters lightClusters(cullLightsOnGpu);
+    lightClusters.SetProjection(projection, nearPlane, farPlane);
 
     int scrWidth, scrHeight;
     glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
@@ -437,6 +581,44 @@ int main()
     float theta[8] = {0, PI / 4.0f, PI / 2.0f, PI * 3 / 4.0f, PI, PI * 5 / 4.0f, PI * 3 / 2.0f, PI * 7 / 4.0f}; // rotate angle
     const float circleR = 4.0f;
 
+    // scene
+    // ------every object is an instance of the bvh. they move each frame, which only refits the tree
+    SceneBVH scene;
+    std::vector<SceneObject> sceneObjects;
+    auto addObject = [&](unsigned int geometry, const MaterialMaps& maps, const std::string& name)
+    {
+        SceneObject object = { geometry, pbrShaders.Get(materialDefines(maps)), &maps, name };
+        sceneObjects.push_back(object);
+        return scene.Add(renderer.Bounds(geometry), glm::mat4(1.0f));
+    };
+    unsigned int headInstance = addObject(headGeometry, headMaps, "head");
+    unsigned int visorInstance = addObject(visorGeometry, visorMaps, "visor");
+    unsigned int bakemyscanInstance = addObject(bakemyscanGeometry, scanMaps, "bakemyscan");
+    unsigned int sphereInstances[sphereNum];
+    for (int i = 0; i < sphereNum; i++)
+        sphereInstances[i] = addObject(sphereGeometry, sphereMaps[i], "sphere " + twoInputPath[i].substr(1, twoInputPath[i].size() - 2));
+
+    auto placeObjects = [&](float radian)
+    {
+        glm::mat4 helmetModel = glm::scale(glm::mat4(1.0f), glm::vec3(2.6f));
+        placePbrModel(scene, headInstance, helmetModel);
+        placePbrModel(scene, visorInstance, helmetModel);
+        glm::mat4 scanModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f)), glm::vec3(9.0f));
+        placePbrModel(scene, bakemyscanInstance, scanModel);
+        for (int i = 0; i < sphereNum; i++)
+            placePbrSphere(scene, sphereInstances[i], circleR, theta[i], radian);
+    };
+    placeObjects(0.0f);
+    scene.Build();
+
+    // the frame itself, shared with asset-pipeline frame-allocations
+    PbrFrame pbrFrame(textureLoader, lightBuffer, lightClusters, frameData, pbrShaders, objectRing, renderer, scene, sceneObjects);
+    pbrFrame.SetAnimatedLights(animatedLights);
+    pbrFrame.SetIBL(irradianceMap, prefilterMap, brdfLUTTexture);
+    bool pickHeld = false;
+
+    float lastStatsTime = 0.0f;
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -448,82 +630,46 @@ int main()
         // input
         processInput(window);
 
-        // render
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        pbrShader.use();
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        pbrShader.setMat4("view", view);
-        pbrShader.setVec3("camPos", camera.Position);
-
-        // irradiance map
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-        
         float radian = -glfwGetTime() * 0.4f;
+        placeObjects(radian);
 
-        model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(2.6, 2.6, 2.6));
-        renderPbrModel(pbrMaterialUBO,modelAlbedoMap, modelNormalMap, modelMetallicMap, modelRoughnessMap, modelAoMapModel, circleR, theta[8], radian, pbrShader, head, model);
-        renderPbrModel(pbrMaterialUBO,modelAlbedoMap2, modelNormalMap2, modelMetallicMap2, modelRoughnessMap2, modelAoMapModel2, circleR, theta[8], radian, pbrShader, visor, model);
-        //renderPbrModel(modelAlbedoMap, modelNormalMap, modelMetallicMap, modelRoughnessMap, modelAoMapModel, pbrShader, head, model);
-        //renderPbrModel(modelAlbedoMap2, modelNormalMap2, modelMetallicMap2, modelRoughnessMap2, modelAoMapModel2, pbrShader, visor, model);
-
-        model = glm::mat4(1.0f);       
-        model = glm::translate(model, glm::vec3(10, 0, 0));
-        model = glm::scale(model, glm::vec3(9, 9, 9));
-        renderPbrModel(pbrMaterialUBO,modelAlbedoMap3, modelNormalMap3, modelMetallicMap3, modelRoughnessMap3, modelAoMapModel3, circleR, theta[0], radian, pbrShader, bakemyscan, model);
-        //renderPbrModel(modelAlbedoMap3, modelNormalMap3, modelMetallicMap3, modelRoughnessMap3, modelAoMapModel3, pbrShader, bakemyscan, model);
-
-      
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        FrameData frame = FrameData::Camera(camera.GetViewMatrix(), projection, currentFrame, exposure);
+        pbrFrame.Render(frame, fovY, lodPixelError, framebufferWidth, framebufferHeight, [&]()
+        {
+            // cubemap
+            backgroundShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+            renderCube();
+        });
 
-        for (int i = 0; i < sphereNum; i++)
+        // left click picks the object under the crosshair
+        bool pickDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (pickDown && !pickHeld)
         {
-            renderPbrSphere(pbrMaterialUBO, sphereMap[i][0], sphereMap[i][1], sphereMap[i][2], sphereMap[i][3], sphereMap[i][4], circleR, theta[i], radian, pbrShader);
-            //renderPbrSphere(sphereMap[i][0], sphereMap[i][1], sphereMap[i][2], sphereMap[i][3], sphereMap[i][4], circleR, theta[i], radian, pbrShader);
+            unsigned int picked;
+            float distance;
+            if (scene.Raycast(camera.Position, camera.Front, picked, distance))
+                std::cout << "picked " << sceneObjects[picked].name << " at " << distance << std::endl;
         }
+        pickHeld = pickDown;
 
-        Light_Info light_temp_array[6];
-       for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+        // culling counters of the last frame and the object closest to the camera in the title, twice a second
+        if (currentFrame - lastStatsTime > 0.5f)
         {
-            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin(glfwGetTime() * 5.0) * 5.0, 0.0, 0.0);
-            //glm::vec3 newPos = lightPositions[i];
-
-            //push light position and color to vector and then upload to ssboLight
-            
-            light_temp_array[i].position = glm::vec4(newPos,0);
-            light_temp_array[i].color = glm::vec4(lightColors[i],0);
-            //Light_Array_Info.push_back(light_temp_array[i]);
-            
-            //glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboLight);
-            //glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(Light_Info), sizeof(Light_Info), &light_temp_array[i]); //to update partially
-            
-            //pbrShader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-            //pbrShader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, newPos);
-            model = glm::scale(model, glm::vec3(0.5f));
-            pbrShader.setMat4("model", model);
+            unsigned int nearest = 0;
+            float nearestDistance = 0.0f;
+            bool foundNearest = scene.Nearest(camera.Position, nearest, nearestDistance);
+            char title[256];
+            snprintf(title, sizeof(title), "PBR Render with IBL - %u/%u objects, %u draws visible, %u culled, %u back-facing, %zu triangles, nearest %s",
+                (unsigned int)pbrFrame.VisibleInstances().size(), scene.Count(), renderer.Visible(), renderer.Culled(), renderer.Backfacing(), renderer.Triangles(),
+                foundNearest ? sceneObjects[nearest].name.c_str() : "-");
+            glfwSetWindowTitle(window, title);
+            lastStatsTime = currentFrame;
         }
 
-       glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboLight);
-       glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Light_Info) * 6, &light_temp_array[0]); //to update all light info to fs
-
-
-       // cubemap
-       backgroundShader.use();
-       backgroundShader.setMat4("view", view);
-       glActiveTexture(GL_TEXTURE0);
-       glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-       renderCube();
-
        //brdfShader.use();
        //renderQuad();
 
@@ -532,11 +678,12 @@ int main()
        glfwPollEvents();
     }
 
-    glfwTerminate();
     return 0;
 }
 
-void renderPbrSphere(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, float circleR, float theta, float radian, Shader& pbrShader)
+// moves a sphere along its orbit
+// ------------------------------------------------------------------------
+void placePbrSphere(SceneBVH& scene, unsigned int instance, float circleR, float theta, float radian)
 {
     // pbr texture
     // old way
@@ -551,17 +698,6 @@ void renderPbrSphere(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMa
     //glActiveTexture(GL_TEXTURE7);
     //glBindTexture(GL_TEXTURE_2D, aoMap);
     
-    /* ubo upload
-    */
-    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GLuint64), &albedoMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 1 * sizeof(GLuint64), sizeof(GLuint64), &normalMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(GLuint64), sizeof(GLuint64), &metallicMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 3 * sizeof(GLuint64), sizeof(GLuint64), &roughnessMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 4 * sizeof(GLuint64), sizeof(GLuint64), &aoMap);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    
-    
     //bindless upload
     /*
     glUniformHandleui64ARB(glGetUniformLocation(pbrShader.ID, "albedoMap"), albedoMap);
@@ -576,8 +712,8 @@ void renderPbrSphere(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMa
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(px, py, 0.0f));
     model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-    pbrShader.setMat4("model", model);
-    renderSphere();
+
+    scene.SetTransform(instance, model);
 }
 /*
 void renderPbrSphere(unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, float circleR, float theta, float radian, Shader& pbrShader)
@@ -605,7 +741,9 @@ renderSphere();
 }
 */
 
-void renderPbrModel(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, float circleR, float theta, float radian, Shader& pbrShader, Model inputModel, glm::mat4 model)
+// spins a model in place
+// ------------------------------------------------------------------------
+void placePbrModel(SceneBVH& scene, unsigned int instance, glm::mat4 model)
 {
     // pbr texture
     //glActiveTexture(GL_TEXTURE3);
@@ -619,14 +757,6 @@ void renderPbrModel(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap
     //glActiveTexture(GL_TEXTURE7);
     //glBindTexture(GL_TEXTURE_2D, aoMap);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GLuint64), &albedoMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 1 * sizeof(GLuint64), sizeof(GLuint64), &normalMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 2 * sizeof(GLuint64), sizeof(GLuint64), &metallicMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 3 * sizeof(GLuint64), sizeof(GLuint64), &roughnessMap);
-    glBufferSubData(GL_UNIFORM_BUFFER, 4 * sizeof(GLuint64), sizeof(GLuint64), &aoMap);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    
     /*
     
     glUniformHandleui64ARB(glGetUniformLocation(pbrShader.ID, "albedoMap"), albedoMap);
@@ -636,13 +766,11 @@ void renderPbrModel(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap
     glUniformHandleui64ARB(glGetUniformLocation(pbrShader.ID, "aoMap"), aoMap);
     */
 
-    float px = circleR * cos(theta - radian);
-    float py = circleR * sin(theta - radian);
     model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
 
-    pbrShader.setMat4("model", model);
-    inputModel.Draw(pbrShader);
+    scene.SetTransform(instance, model);
 }
+
 /*
 void renderPbrModel(GLuint64 ubo, unsigned int albedoMap, unsigned int normalMap, unsigned int metallicMap, unsigned int roughnessMap, unsigned int aoMap, Shader& pbrShader, Model inputModel, glm::mat4 model)
 {
@@ -713,99 +841,82 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(yoffset);
 }
 
-unsigned int sphereVAO = 0;
-unsigned int indexCount;
-void renderSphere()
+// appends the meshes of the model at path from its mesh cache, importing the model and writing the cache on a miss.
+// the cache stays mapped until the renderer's Upload(), returns the geometry id
+// ------------------------------------------------------------------------
+unsigned int addModel(IndirectRenderer& renderer, MeshCache& cache, const std::string& path)
 {
-    if (sphereVAO == 0)
-    {
-        glGenVertexArrays(1, &sphereVAO);
-
-        unsigned int vbo, ebo;
-        glGenBuffers(1, &vbo);
-        glGenBuffers(1, &ebo);
+    if (cache.Load())
+        return renderer.Add(cache);
 
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec2> uv;
-        std::vector<glm::vec3> normals;
-        std::vector<unsigned int> indices;
+    Model model(path);
+    if (cache.Save(model.meshes, model.materials) && cache.Load())
+    {
+        std::cout << "Wrote mesh cache " << cache.CachePath << std::endl;
+        return renderer.Add(cache);
+    }
+    // cannot write next to the model, copy the imported meshes instead
+    return renderer.Add(model);
+}
 
-        const unsigned int X_SEGMENTS = 64;
-        const unsigned int Y_SEGMENTS = 64;
-        const float PI = 3.14159265359;
-        for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
-        {
-            for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
-            {
-                float xSegment = (float)x / (float)X_SEGMENTS;
-                float ySegment = (float)y / (float)Y_SEGMENTS;
-                float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-                float yPos = std::cos(ySegment * PI);
-                float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-
-                positions.push_back(glm::vec3(xPos, yPos, zPos));
-                uv.push_back(glm::vec2(xSegment, ySegment));
-                normals.push_back(glm::vec3(xPos, yPos, zPos));
-            }
-        }
+// appends a uv sphere and its levels of detail to the indirect renderer's arenas as a triangle list, returns its geometry id
+// ------------------------------------------------------------------------
+unsigned int addSphere(IndirectRenderer& renderer)
+{
+    std::vector<IndirectRenderer::ArenaVertex> vertices;
+    std::vector<unsigned int> indices;
 
-        bool oddRow = false;
-        for (int y = 0; y < Y_SEGMENTS; ++y)
+    const unsigned int X_SEGMENTS = 64;
+    const unsigned int Y_SEGMENTS = 64;
+    const float PI = 3.14159265359;
+    for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
+    {
+        for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
         {
-            if (!oddRow) // even rows: y == 0, y == 2; and so on
-            {
-                for (int x = 0; x <= X_SEGMENTS; ++x)
-                {
-                    indices.push_back(y * (X_SEGMENTS + 1) + x);
-                    indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-                }
-            }
-            else
-            {
-                for (int x = X_SEGMENTS; x >= 0; --x)
-                {
-                    indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-                    indices.push_back(y * (X_SEGMENTS + 1) + x);
-                }
-            }
-            oddRow = !oddRow;
+            float xSegment = (float)x / (float)X_SEGMENTS;
+            float ySegment = (float)y / (float)Y_SEGMENTS;
+            float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+            float yPos = std::cos(ySegment * PI);
+            float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+
+            IndirectRenderer::ArenaVertex vertex;
+            vertex.Position = glm::vec3(xPos, yPos, zPos);
+            vertex.TexCoords = glm::vec2(xSegment, ySegment);
+            vertex.Normal = glm::vec3(xPos, yPos, zPos);
+            // along increasing xSegment, the bitangent (increasing ySegment) is on the positive side of cross(normal, tangent)
+            vertex.Tangent = glm::vec4(-std::sin(xSegment * 2.0f * PI), 0.0f, std::cos(xSegment * 2.0f * PI), 1.0f);
+            vertices.push_back(vertex);
         }
-        indexCount = indices.size();
+    }
 
-        std::vector<float> data;
-        for (int i = 0; i < positions.size(); ++i)
+    // the same two triangles per quad, with the same winding, as the old strip
+    for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+    {
+        for (unsigned int x = 0; x < X_SEGMENTS; ++x)
         {
-            data.push_back(positions[i].x);
-            data.push_back(positions[i].y);
-            data.push_back(positions[i].z);
-            if (uv.size() > 0)
-            {
-                data.push_back(uv[i].x);
-                data.push_back(uv[i].y);
-            }
-            if (normals.size() > 0)
-            {
-                data.push_back(normals[i].x);
-                data.push_back(normals[i].y);
-                data.push_back(normals[i].z);
-            }
+            unsigned int i0 = y * (X_SEGMENTS + 1) + x;
+            unsigned int i1 = (y + 1) * (X_SEGMENTS + 1) + x;
+            indices.push_back(i0);
+            indices.push_back(i1);
+            indices.push_back(i0 + 1);
+            indices.push_back(i0 + 1);
+            indices.push_back(i1);
+            indices.push_back(i1 + 1);
         }
-        glBindVertexArray(sphereVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        float stride = (3 + 2 + 3) * sizeof(float);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
     }
 
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+    // the pole rows stay put, the seam column only slides along itself, the rest of the sphere is simplified
+    std::vector<glm::vec3> positions(vertices.size()), normals(vertices.size());
+    std::vector<glm::vec2> texCoords(vertices.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        positions[i] = vertices[i].Position;
+        normals[i] = vertices[i].Normal;
+        texCoords[i] = vertices[i].TexCoords;
+    }
+    std::vector<MeshLod> lods;
+    MeshSimplifier::BuildLods(indices, positions, normals, texCoords, lods);
+    return renderer.Add(vertices, indices, lods);
 }
 
 unsigned int cubeVAO = 0;
@@ -881,46 +992,6 @@ void renderCube()
     glBindVertexArray(0);
 }
 
-unsigned int loadTexture(char const* path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    unsigned int handleID = glGetTextureHandleARB(textureID);
-    glMakeTextureHandleResidentARB(handleID);
-
-    return handleID;
-}
-
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
 void renderQuad()
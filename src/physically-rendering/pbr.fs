@@ -1,9 +1,20 @@
 #version 460 core
 #extension GL_ARB_bindless_texture : require
+// feature defines, injected by Shader after #version. every combination is its own program, see ShaderPermutations
+// HAS_NORMAL_MAP     perturb the normal with the material's normal map, otherwise use the interpolated vertex normal
+// PACKED_ORM         ao, roughness and metallic come from the r, g, b of one ormMap
+// USE_SH_IRRADIANCE  diffuse IBL from the spherical harmonics block instead of irradianceMap
+// USE_ANALYTIC_BRDF  closed form split sum instead of sampling brdfLUT
+// TONEMAP            Reinhard and gamma at the end, leave it out when a later pass does both
 out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
+#ifdef HAS_NORMAL_MAP
+// xyz tangent, w bitangent sign
+in vec4 Tangent;
+#endif
+flat in uint ObjectIndex;
 
 // material parameters
 //uniform sampler2D albedoMap;
@@ -12,54 +23,149 @@ in vec3 Normal;
 //uniform sampler2D roughnessMap;
 //uniform sampler2D aoMap;
 
-layout (std140) uniform pbrMaterial
+// mirrors PbrMaterial in main.cpp
+struct PbrMaterial
 {
     sampler2D albedoMap;
     sampler2D normalMap;
     sampler2D metallicMap;
     sampler2D roughnessMap;
     sampler2D aoMap;
+    // ao, roughness and metallic in r, g, b (asset-pipeline pack-orm). replaces the three maps above with PACKED_ORM
+    sampler2D ormMap;
+    // set for packed materials, which are drawn with the PACKED_ORM permutation
+    bool packedORM;
+};
+
+// per-object records of this frame, ObjectIndex comes from the base instance of the draw. same block as in pbr.vs
+struct Object_Info
+{
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+    PbrMaterial material;
+};
+
+layout(std430, binding = 5) readonly buffer Object_Data
+{
+    Object_Info objectArray[];
 };
 
 // IBL
+#ifdef USE_SH_IRRADIANCE
+// diffuse irradiance as order 2 spherical harmonics.
+// coefficients are pre-convolved with the cosine lobe and divided by PI, see sh_project.comp
+layout (std140, binding = 4) uniform SHIrradiance
+{
+    vec4 shCoefficients[9];
+};
+#else
 uniform samplerCube irradianceMap;
+#endif
 uniform samplerCube prefilterMap;
+#ifndef USE_ANALYTIC_BRDF
+// split sum scale and bias in rg, multiscatter energy compensation in b when the LUT was generated with it.
+// low-end machines use the closed form fit instead, the LUT is then never sampled (or loaded)
 uniform sampler2D brdfLUT;
+#endif
 
-// lights
+// lights, position.w is the radius of influence
 struct Light_Info
 {
     vec4 position;
     vec4 color;
 };
 
+// the count header of the buffer is followed by the lights, see LightBuffer
 layout(std430,binding = 2) buffer Light_Data
 {
+    uint lightCount;
     Light_Info lightArray[];
 };
+
+// clustered light lists, see LightClusters. tiles x, tiles y and depth slices are kept in sync with it
+const uvec3 CLUSTER_GRID = uvec3(16, 9, 24);
+
+// offset into lightIndexArray and light count of every cluster
+layout(std430, binding = 6) readonly buffer Cluster_Data
+{
+    uvec2 clusterArray[];
+};
+
+layout(std430, binding = 7) readonly buffer Light_Index_Data
+{
+    uint lightIndexArray[];
+};
+
+// first cluster of this frame in Cluster_Data
+uniform int clusterBase;
+// pixels per tile
+uniform vec2 clusterTileSize;
+// near, far, slice scale, slice bias
+uniform vec4 clusterDepth;
 //uniform vec3 lightPositions[4];
 //uniform vec3 lightColors[4];
 
-uniform vec3 camPos;
+// same block as in pbr.vs
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec3 camPos;
+    float time;
+    float exposure;
+};
 
 const float PI = 3.14159265359;
 
-vec3 getNormalFromMap()
+#ifdef USE_SH_IRRADIANCE
+vec3 irradianceSH(vec3 n)
 {
-    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
-
-    vec3 Q1  = dFdx(WorldPos);
-    vec3 Q2  = dFdy(WorldPos);
-    vec2 st1 = dFdx(TexCoords);
-    vec2 st2 = dFdy(TexCoords);
+    vec3 irradiance = shCoefficients[0].rgb * 0.282095
+                    + shCoefficients[1].rgb * 0.488603 * n.y
+                    + shCoefficients[2].rgb * 0.488603 * n.z
+                    + shCoefficients[3].rgb * 0.488603 * n.x
+                    + shCoefficients[4].rgb * 1.092548 * n.x * n.y
+                    + shCoefficients[5].rgb * 1.092548 * n.y * n.z
+                    + shCoefficients[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+                    + shCoefficients[7].rgb * 1.092548 * n.x * n.z
+                    + shCoefficients[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(irradiance, vec3(0.0));
+}
+#endif
+// ----------------------------------------------------------------------------
+// Karis, "Physically Based Shading on Mobile": analytic approximation of the split sum scale and bias
+vec2 envBRDFApprox(float NdotV, float roughness)
+{
+    const vec4 c0 = vec4(-1.0, -0.0275, -0.572, 0.022);
+    const vec4 c1 = vec4(1.0, 0.0425, 1.04, -0.04);
+    vec4 r = roughness * c0 + c1;
+    float a004 = min(r.x * r.x, exp2(-9.28 * NdotV)) * r.x + r.y;
+    return vec2(-1.04, 1.04) * a004 + r.zw;
+}
+// ----------------------------------------------------------------------------
+#ifdef HAS_NORMAL_MAP
+vec3 getNormalFromMap(sampler2D normalMap)
+{
+    // only xy are stored in BC5 normal maps, rebuild z. it gives the same vector for uncompressed maps
+    vec3 tangentNormal;
+    tangentNormal.xy = texture(normalMap, TexCoords).rg * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
+    // the vertex tangent frame, made orthogonal to the interpolated normal again. it is oriented like the screen
+    // derivative frame this used before (T along dP/du times the handedness of the uvs), so the normal maps read the same
     vec3 N   = normalize(Normal);
-    vec3 T  = normalize(Q1*st2.t - Q2*st1.t);
-    vec3 B  = -normalize(cross(N, T));
+    vec3 T   = normalize(Tangent.xyz - dot(Tangent.xyz, N) * N) * (Tangent.w < 0.0 ? -1.0 : 1.0);
+    vec3 B   = -cross(N, T);
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
 }
+#endif
 
 float DistributionGGX(vec3 N, vec3 H, float roughness)
 {
@@ -107,32 +213,77 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
 
 }   
 // ----------------------------------------------------------------------------
+// inverse square falloff windowed to reach exactly 0 at the light radius (Karis, "Real Shading in Unreal Engine 4")
+float windowedFalloff(float distance, float radius)
+{
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / max(distance * distance, 0.0001);
+}
+// ----------------------------------------------------------------------------
+uint clusterIndex()
+{
+    // linear view depth from the window depth of the perspective projection
+    float ndcZ = gl_FragCoord.z * 2.0 - 1.0;
+    float depth = 2.0 * clusterDepth.x * clusterDepth.y / (clusterDepth.y + clusterDepth.x - ndcZ * (clusterDepth.y - clusterDepth.x));
+    uint slice = uint(clamp(log(depth) * clusterDepth.z - clusterDepth.w, 0.0, float(CLUSTER_GRID.z - 1)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), CLUSTER_GRID.xy - 1);
+    return uint(clusterBase) + (slice * CLUSTER_GRID.y + tile.y) * CLUSTER_GRID.x + tile.x;
+}
+// ----------------------------------------------------------------------------
 void main()
 {
     //material
-    vec3 albedo = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2));
-    float metallic = texture(metallicMap, TexCoords).r;
-    float roughness = texture(roughnessMap, TexCoords).r;
-    float ao = texture(aoMap, TexCoords).r;
+    PbrMaterial material = objectArray[ObjectIndex].material;
+    vec3 albedo = pow(texture(material.albedoMap, TexCoords).rgb, vec3(2.2));
+#ifdef PACKED_ORM
+    vec3 orm = texture(material.ormMap, TexCoords).rgb;
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metallic = orm.b;
+#else
+    float metallic = texture(material.metallicMap, TexCoords).r;
+    float roughness = texture(material.roughnessMap, TexCoords).r;
+    float ao = texture(material.aoMap, TexCoords).r;
+#endif
 
-    vec3 N = getNormalFromMap();
+#ifdef HAS_NORMAL_MAP
+    vec3 N = getNormalFromMap(material.normalMap);
+#else
+    vec3 N = normalize(Normal);
+#endif
     vec3 V = normalize(camPos - WorldPos);
     vec3 R = reflect(-V, N); 
  
     vec3 F0 = vec3(0.04); 
     F0 = mix(F0, albedo, metallic);
 
-    // calculate integral
+    float NdotV = max(dot(N, V), 0.0);
+#ifdef USE_ANALYTIC_BRDF
+    vec3 brdf = vec3(envBRDFApprox(NdotV, roughness), 0.0);
+#else
+    vec3 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rgb;
+#endif
+    // single scattering loses energy at high roughness, scale every specular lobe back up (b is 0 without the channel)
+    vec3 energyCompensation = 1.0 + F0 * brdf.b;
+
+    // calculate integral over the lights of this fragment's cluster
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 6; ++i) 
+    uvec2 cluster = clusterArray[clusterIndex()];
+    for(uint c = 0; c < cluster.y; ++c) 
     {
+        uint i = lightIndexArray[cluster.x + c];
+        // the lists are conservative, skip lights whose range ends before this fragment
+        float distance = length(lightArray[i].position.xyz - WorldPos);
+        if (distance > lightArray[i].position.w)
+            continue;
+
         // calculate per-light radiance
         //vec3 L = normalize(lightPositions[i] - WorldPos);
         vec3 L = normalize(lightArray[i].position.xyz - WorldPos);
         vec3 H = normalize(V + L);
         //float distance = length(lightPositions[i] - WorldPos);
-        float distance = length(lightArray[i].position.xyz - WorldPos);
-        float attenuation = 1.0 / (distance * distance);
+        float attenuation = windowedFalloff(distance, lightArray[i].position.w);
         //vec3 radiance = lightColors[i] * attenuation;
         vec3 radiance = lightArray[i].color.xyz * attenuation;
 
@@ -143,7 +294,7 @@ void main()
         
         vec3 nominator    = NDF * G * F;
         float denominator = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.001;
-        vec3 specular = nominator / denominator;
+        vec3 specular = nominator / denominator * energyCompensation;
         
         vec3 kS = F;
         vec3 kD = vec3(1.0) - kS;
@@ -152,28 +303,34 @@ void main()
         Lo += (kD * albedo / PI + specular) * radiance * NdotL; 
     }   
     
-    vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
+    vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
     
     vec3 kS = F;
     vec3 kD = 1.0 - kS;
     kD *= 1.0-metallic;	  
     
+#ifdef USE_SH_IRRADIANCE
+    vec3 irradiance = irradianceSH(N);
+#else
     vec3 irradiance = texture(irradianceMap, N).rgb;
+#endif
     vec3 diffuse      = irradiance * albedo;
     
     const float MAX_REFLECTION_LOD = 4.0;
     vec3 prefilteredColor = textureLod(prefilterMap, R,  roughness * MAX_REFLECTION_LOD).rgb;    
-    vec2 brdf  = texture(brdfLUT, vec2(max(dot(N, V), 0.0), roughness)).rg;
-    vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
+    vec3 specular = prefilteredColor * (F * brdf.x + brdf.y) * energyCompensation;
 
     vec3 ambient = (kD * diffuse + specular) * ao;
     
     vec3 color = ambient + Lo;
 
+    color *= exposure;
+#ifdef TONEMAP
     // HDR tonemapping
     color = color / (color + vec3(1.0));
     // gamma correct
     color = pow(color, vec3(1.0/2.2)); 
+#endif
 
     FragColor = vec4(color, 1.0);
 }
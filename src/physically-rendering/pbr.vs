@@ -1,21 +1,83 @@
-#version 330 core
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+// packed vertex (packed_vertex.h). the position is either floats or unorm16 against the bounds of the geometry, the
+// object record maps it back. normal and tangent are octahedral snorm16, the sign of aTangent.y is the bitangent sign
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
-layout (location = 2) in vec3 aNormal;
+layout (location = 2) in vec2 aNormal;
+layout (location = 3) in vec2 aTangent;
 
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+#ifdef HAS_NORMAL_MAP
+out vec4 Tangent;
+#endif
+flat out uint ObjectIndex;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+// per view data, written once per frame into a ring of uniform buffers (FrameDataBuffer)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec3 camPos;
+    float time;
+    float exposure;
+};
+
+// same block as in pbr.fs, a program links only if both declarations match
+struct PbrMaterial
+{
+    sampler2D albedoMap;
+    sampler2D normalMap;
+    sampler2D metallicMap;
+    sampler2D roughnessMap;
+    sampler2D aoMap;
+    sampler2D ormMap;
+    bool packedORM;
+};
+
+struct Object_Info
+{
+    mat4 model;
+    // position = positionOffset + positionScale * aPos, w unused
+    vec4 positionOffset;
+    vec4 positionScale;
+    PbrMaterial material;
+};
+
+layout(std430, binding = 5) readonly buffer Object_Data
+{
+    Object_Info objectArray[];
+};
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main()
 {
+    // every draw is a single instance whose base instance is the index of its record
+    ObjectIndex = uint(gl_BaseInstance);
+    mat4 model = objectArray[ObjectIndex].model;
+    vec3 position = objectArray[ObjectIndex].positionOffset.xyz + objectArray[ObjectIndex].positionScale.xyz * aPos;
+
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(model) * aNormal;   
+    WorldPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(model) * octDecode(aNormal);
+#ifdef HAS_NORMAL_MAP
+    // the second component was moved to (0, 1] to carry the sign
+    vec2 tangent = vec2(aTangent.x, abs(aTangent.y) * 2.0 - 1.0);
+    Tangent = vec4(mat3(model) * octDecode(tangent), aTangent.y < 0.0 ? -1.0 : 1.0);
+#endif
 
-    gl_Position =  projection * view * vec4(WorldPos, 1.0);
-}
\ No newline at end of file
+    gl_Position =  viewProjection * vec4(WorldPos, 1.0);
+}